@@ -0,0 +1,298 @@
+/*
+  File: bench.c
+  Date: 10/19/2026
+  Author: Mitchell Goff
+*/
+
+
+
+/* =============================== *
+
+             Includes
+
+ * =============================== */
+
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "../include/hardware.h"
+#include "../include/yalnix.h"
+#include "../include/custom.h"
+
+#include "threads.h"
+#include "threads.c"
+#include "stats.h"
+#include "stats.c"
+
+
+
+
+
+/* =============================== *
+
+               Data
+
+ * =============================== */
+
+/*
+  A fixed set of kernel microbenchmarks. Every benchmark runs a few warmup
+  iterations, then times each of its iterations with the cycle counter and
+  reports one line on the console:
+
+    bench <name> <ops> <ticks> <ops/tick> <min> <p50> <p90> <p99> <max>
+
+  where the last five columns are cycles per operation. "make bench" has init
+  start this and collects those lines, so they can be compared against a baseline.
+*/
+
+#ifndef BENCH_ITERATIONS
+#define BENCH_ITERATIONS 500
+#endif
+
+#define BENCH_WARMUP 8
+
+// Fork and exec are much slower than everything else, so they get fewer iterations
+#define BENCH_PROCESS_ITERATIONS (BENCH_ITERATIONS / 10)
+
+#define BENCH_BRK_PAGES 8
+#define BENCH_COW_PAGES 16
+#define BENCH_TTY_BYTES 256
+#define BENCH_TTY_ITERATIONS 32
+#define BENCH_TTY 1
+
+// Passed to ourselves through Exec, so the child exits straight away
+#define BENCH_EXIT_ARG "exit"
+
+typedef void (*BenchOp) (int iteration);
+
+static char *program_name;
+static unsigned int samples[BENCH_ITERATIONS];
+
+static int lock, cvar, turn, done;
+static char *brk_base;
+static char tty_buffer[BENCH_TTY_BYTES];
+static char cow_buffer[BENCH_COW_PAGES][PAGESIZE];
+
+
+
+
+
+/* =============================== *
+
+             Harness
+
+ * =============================== */
+
+static inline unsigned long long readCycles() {
+	unsigned int low, high;
+	__asm__ volatile ("rdtsc" : "=a" (low), "=d" (high));
+	return (unsigned long long) high << 32 | low;
+}
+
+static int compareSamples(const void *a, const void *b) {
+	unsigned int x = *(const unsigned int *) a, y = *(const unsigned int *) b;
+	return x < y ? -1 : x > y;
+}
+
+
+
+
+/*
+  Run $op $iterations times after $warmup untimed runs, then print the results.
+*/
+
+static void runBenchmark(char *name, BenchOp op, int iterations, int warmup) {
+	if (iterations > BENCH_ITERATIONS) iterations = BENCH_ITERATIONS;
+
+	for (int i=0; i<warmup; i++) op(i);
+
+	int start_ticks = GetClockTicks();
+	for (int i=0; i<iterations; i++) {
+		unsigned long long start = readCycles();
+		op(i);
+		unsigned long long cycles = readCycles() - start;
+		samples[i] = cycles > 0xFFFFFFFF ? 0xFFFFFFFF : cycles;
+	}
+	int ticks = GetClockTicks() - start_ticks;
+
+	qsort(samples, iterations, sizeof(samples[0]), compareSamples);
+
+	TtyPrintf(TTY_CONSOLE, "bench %s %d %d %d %u %u %u %u %u\n", name, iterations, ticks,
+		ticks ? iterations / ticks : iterations, samples[0], samples[iterations / 2],
+		samples[iterations * 9 / 10], samples[iterations * 99 / 100], samples[iterations - 1]);
+}
+
+
+
+
+
+/* =============================== *
+
+            Benchmarks
+
+ * =============================== */
+
+// A syscall that does nothing, to measure the cost of getting in and out of the kernel
+static void benchNop(int i) {
+	Nop(0, 0, 0, 0);
+}
+
+static void benchForkWait(int i) {
+	int status;
+	if (Fork() == 0) Exit(0);
+	Wait(&status);
+}
+
+static void benchForkExecWait(int i) {
+	int status;
+	if (Fork() == 0) {
+		char *args[] = {program_name, BENCH_EXIT_ARG, NULL};
+		Exec(program_name, args);
+		Exit(ERROR);
+	}
+	Wait(&status);
+}
+
+static void emptyThread(void *arg) {}
+
+static void benchThreadJoin(int i) {
+	JoinThread(CreateThread(emptyThread, 0));
+}
+
+
+
+
+/*
+  Locks and condition variables. The contended benchmark keeps a second thread
+  queued on the lock, so every Acquire has to wait for it to be handed over.
+*/
+
+static void benchLock(int i) {
+	Acquire(lock);
+	Release(lock);
+}
+
+static void lockContender(void *arg) {
+	while (1) {
+		Acquire(lock);
+		int finished = done;
+		Release(lock);
+		if (finished) return;
+	}
+}
+
+// Bounce between two threads: we hand the turn over, then wait to get it back
+static void cvarPonger(void *arg) {
+	Acquire(lock);
+	while (1) {
+		while (!turn && !done) CvarWait(cvar, lock);
+		if (done) break;
+
+		turn = 0;
+		CvarSignal(cvar);
+	}
+	Release(lock);
+}
+
+static void benchCvarPingPong(int i) {
+	Acquire(lock);
+	turn = 1;
+	CvarSignal(cvar);
+	while (turn) CvarWait(cvar, lock);
+	Release(lock);
+}
+
+
+
+
+/*
+  Memory. Each Brk iteration grows the heap by BENCH_BRK_PAGES and shrinks it back,
+  and each copy-on-write iteration is the first write to a page shared with our parent.
+*/
+
+static void benchBrk(int i) {
+	Brk(brk_base + BENCH_BRK_PAGES*PAGESIZE);
+	Brk(brk_base);
+}
+
+static void benchCopyOnWrite(int i) {
+	cow_buffer[i][0]++;
+}
+
+static void benchTtyWrite(int i) {
+	TtyWrite(BENCH_TTY, tty_buffer, BENCH_TTY_BYTES);
+}
+
+
+
+
+
+/* =============================== *
+
+             Functions
+
+ * =============================== */
+
+static void runAllBenchmarks() {
+	int status;
+
+	runBenchmark("null_syscall", benchNop, BENCH_ITERATIONS, BENCH_WARMUP);
+	runBenchmark("fork_wait", benchForkWait, BENCH_PROCESS_ITERATIONS, 1);
+	runBenchmark("fork_exec_wait", benchForkExecWait, BENCH_PROCESS_ITERATIONS, 1);
+	runBenchmark("thread_create_join", benchThreadJoin, BENCH_PROCESS_ITERATIONS, 1);
+
+	LockInit(&lock);
+	CvarInit(&cvar);
+	runBenchmark("lock_uncontended", benchLock, BENCH_ITERATIONS, BENCH_WARMUP);
+
+	// Hold the lock until the contender has queued up behind us
+	done = 0;
+	Acquire(lock);
+	int contender = CreateThread(lockContender, 0);
+	Delay(1);
+	Release(lock);
+	runBenchmark("lock_contended", benchLock, BENCH_ITERATIONS, BENCH_WARMUP);
+	done = 1;
+	JoinThread(contender);
+
+	done = 0;
+	turn = 0;
+	int ponger = CreateThread(cvarPonger, 0);
+	runBenchmark("cvar_ping_pong", benchCvarPingPong, BENCH_ITERATIONS, BENCH_WARMUP);
+	Acquire(lock);
+	done = 1;
+	CvarSignal(cvar);
+	Release(lock);
+	JoinThread(ponger);
+
+	brk_base = (char *) UP_TO_PAGE(sbrk(0));
+	runBenchmark("brk_grow_shrink", benchBrk, BENCH_ITERATIONS, BENCH_WARMUP);
+
+	// Touch every page so it's really ours, then fault on the shared copies in a child
+	memset(cow_buffer, 0x00, sizeof(cow_buffer));
+	if (Fork() == 0) {
+		runBenchmark("cow_fault", benchCopyOnWrite, BENCH_COW_PAGES, 0);
+		Exit(0);
+	}
+	Wait(&status);
+
+	memset(tty_buffer, '.', BENCH_TTY_BYTES - 1);
+	tty_buffer[BENCH_TTY_BYTES - 1] = '\n';
+	runBenchmark("tty_write_256", benchTtyWrite, BENCH_TTY_ITERATIONS, 1);
+}
+
+
+
+
+int main(int argc, char *argv[]) {
+	if (argc > 1 && strcmp(argv[1], BENCH_EXIT_ARG) == 0) Exit(0);
+	program_name = argc > 0 ? argv[0] : "apps/bench";
+
+	TtyPrintf(TTY_CONSOLE, "Running benchmarks: name ops ticks ops/tick, then min p50 p90 p99 max cycles\n");
+	runAllBenchmarks();
+	TtyPrintf(TTY_CONSOLE, "Benchmarks done\n");
+
+	Exit(0);
+	return 0;
+}
@@ -0,0 +1,74 @@
+/*
+  File: futex.c
+  Date: 10/19/2026
+  Author: Mitchell Goff
+*/
+
+
+
+/* =============================== *
+
+  			  Includes
+
+ * =============================== */
+
+#include "../include/hardware.h"
+#include "../include/yalnix.h"
+#include "../include/custom.h"
+
+#include "futex.h"
+
+
+
+
+
+/* =============================== *
+
+  		   Implementation
+
+ * =============================== */
+
+/*
+  Thin wrappers around the kernel's futex calls
+*/
+
+int FutexWait(volatile int *address, int expected) {
+	return Custom2(CUSTOM_FUTEX_WAIT, (int) (long) address, expected, 0);
+}
+
+int FutexWake(volatile int *address, int count) {
+	return Custom2(CUSTOM_FUTEX_WAKE, (int) (long) address, count, 0);
+}
+
+
+
+/*
+  Grab the lock. If it's free this is a single compare-and-swap; otherwise we
+  mark it as contended and sleep in the kernel until the holder wakes us up.
+*/
+
+void FutexAcquire(FutexMutex *mutex) {
+	int state = __sync_val_compare_and_swap(&mutex->state, 0, 1);
+	if (state == 0) return;
+
+	// Someone holds the lock, so make sure they know to wake us up on release
+	if (state != 2) state = __sync_lock_test_and_set(&mutex->state, 2);
+
+	while (state != 0) {
+		FutexWait(&mutex->state, 2);
+		state = __sync_lock_test_and_set(&mutex->state, 2);
+	}
+}
+
+
+
+/*
+  Release the lock, only trapping into the kernel if somebody might be waiting
+*/
+
+void FutexRelease(FutexMutex *mutex) {
+	if (__sync_fetch_and_sub(&mutex->state, 1) != 1) {
+		mutex->state = 0;
+		FutexWake(&mutex->state, 1);
+	}
+}
@@ -0,0 +1,89 @@
+/*
+  File: futex.h
+  Date: 10/19/2026
+  Author: Mitchell Goff
+*/
+
+#ifndef __USER_FUTEX_H__
+#define __USER_FUTEX_H__
+
+
+
+/* =============================== *
+
+  			  Includes
+
+ * =============================== */
+
+#include "../include/hardware.h"
+#include "../include/yalnix.h"
+#include "../include/custom.h"
+
+
+
+
+
+/* =============================== *
+
+  		   Data Structures
+
+ * =============================== */
+
+/*
+  A mutex that lives entirely in user memory. The lock word is one of:
+
+    0: unlocked
+    1: locked, and nobody is waiting
+    2: locked, and somebody might be sleeping in the kernel
+
+  Since the kernel keys its sleepers by address, a FutexMutex has to be shared
+  between threads, not copied across a Fork.
+*/
+
+struct FutexMutex;
+typedef struct FutexMutex FutexMutex;
+
+struct FutexMutex {
+	volatile int state;
+};
+
+
+
+
+
+/* =============================== *
+
+  		      Macros
+
+ * =============================== */
+
+// Statically initialize a futex mutex
+#define futexMutex(name) { 0 }
+
+// Dynamically initialize a futex mutex
+#define futexMutexInit(name) \
+	(name)->state = 0
+
+// Create a new futex mutex variable
+#define newFutexMutex(name) \
+	FutexMutex name = futexMutex(name)
+
+
+
+
+
+/* =============================== *
+
+  		     Interface
+
+ * =============================== */
+
+int FutexWait(volatile int *address, int expected);
+int FutexWake(volatile int *address, int count);
+
+void FutexAcquire(FutexMutex *mutex);
+void FutexRelease(FutexMutex *mutex);
+
+
+
+#endif
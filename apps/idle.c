@@ -27,7 +27,7 @@
 
 int test = 32;
 
-int main() {
+int main(int argc, char *argv[]) {
 	
 	// int pid = Fork();
 	// TracePrintf(1, "Returned from fork! Child's PID: %d\n", pid);
@@ -36,8 +36,11 @@ int main() {
 	// }
 
 
+	// Start whatever program we were given, or apps/test if there isn't one
 	int pid = Fork();
 	if (pid == 0) {
+		if (argc > 1) Exec(argv[1], argv + 1);
+
 		char *args = NULL;
 		Exec("apps/test", &args);
 		// test = 48;
@@ -0,0 +1,61 @@
+/*
+  File: rwlock.c
+  Date: 10/19/2026
+  Author: Mitchell Goff
+*/
+
+
+
+/* =============================== *
+
+  			  Includes
+
+ * =============================== */
+
+#include "../include/hardware.h"
+#include "../include/yalnix.h"
+#include "../include/custom.h"
+
+#include "rwlock.h"
+
+
+
+
+
+/* =============================== *
+
+  		   Implementation
+
+ * =============================== */
+
+/*
+  Create a new reader-writer lock
+*/
+
+int RWLockInit(int *rwlock_id) {
+	return Custom2(CUSTOM_RWLOCK_INIT, (int) (long) rwlock_id, 0, 0);
+}
+
+
+
+/*
+  Acquire the lock for reading or for writing
+*/
+
+int RWLockRead(int rwlock_id) {
+	return Custom2(CUSTOM_RWLOCK_READ, rwlock_id, 0, 0);
+}
+
+int RWLockWrite(int rwlock_id) {
+	return Custom2(CUSTOM_RWLOCK_WRITE, rwlock_id, 0, 0);
+}
+
+
+
+/*
+  Release the lock, however we were holding it
+*/
+
+int RWLockRelease(int rwlock_id) {
+	return Custom2(CUSTOM_RWLOCK_UNLOCK, rwlock_id, 0, 0);
+}
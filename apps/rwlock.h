@@ -0,0 +1,39 @@
+/*
+  File: rwlock.h
+  Date: 10/19/2026
+  Author: Mitchell Goff
+*/
+
+#ifndef __USER_RWLOCK_H__
+#define __USER_RWLOCK_H__
+
+
+
+/* =============================== *
+
+  			  Includes
+
+ * =============================== */
+
+#include "../include/hardware.h"
+#include "../include/yalnix.h"
+#include "../include/custom.h"
+
+
+
+
+
+/* =============================== *
+
+  		     Interface
+
+ * =============================== */
+
+int RWLockInit(int *rwlock_id);
+int RWLockRead(int rwlock_id);
+int RWLockWrite(int rwlock_id);
+int RWLockRelease(int rwlock_id);
+
+
+
+#endif
@@ -0,0 +1,52 @@
+/*
+  File: semaphore.c
+  Date: 10/19/2026
+  Author: Mitchell Goff
+*/
+
+
+
+/* =============================== *
+
+  			  Includes
+
+ * =============================== */
+
+#include "../include/hardware.h"
+#include "../include/yalnix.h"
+#include "../include/custom.h"
+
+#include "semaphore.h"
+
+
+
+
+
+/* =============================== *
+
+  		   Implementation
+
+ * =============================== */
+
+/*
+  Add or take several units at once, in a single trap
+*/
+
+int SemUpN(int sem_id, int count) {
+	return Custom2(CUSTOM_SEM_UP_N, sem_id, count, 0);
+}
+
+int SemDownN(int sem_id, int count) {
+	return Custom2(CUSTOM_SEM_DOWN_N, sem_id, count, 0);
+}
+
+
+
+/*
+  Take $count units if they're available right now. Returns 1 if we got them,
+  0 if we would have blocked, or ERROR.
+*/
+
+int SemTryDown(int sem_id, int count) {
+	return Custom2(CUSTOM_SEM_TRY_DOWN, sem_id, count, 0);
+}
@@ -0,0 +1,38 @@
+/*
+  File: semaphore.h
+  Date: 10/19/2026
+  Author: Mitchell Goff
+*/
+
+#ifndef __USER_SEMAPHORE_H__
+#define __USER_SEMAPHORE_H__
+
+
+
+/* =============================== *
+
+  			  Includes
+
+ * =============================== */
+
+#include "../include/hardware.h"
+#include "../include/yalnix.h"
+#include "../include/custom.h"
+
+
+
+
+
+/* =============================== *
+
+  		     Interface
+
+ * =============================== */
+
+int SemUpN(int sem_id, int count);
+int SemDownN(int sem_id, int count);
+int SemTryDown(int sem_id, int count);
+
+
+
+#endif
@@ -0,0 +1,116 @@
+/*
+  File: stats.c
+  Date: 10/19/2026
+  Author: Mitchell Goff
+*/
+
+
+
+/* =============================== *
+
+  			  Includes
+
+ * =============================== */
+
+#include "../include/hardware.h"
+#include "../include/yalnix.h"
+#include "../include/custom.h"
+
+#include "stats.h"
+
+
+
+
+
+/* =============================== *
+
+  		   Implementation
+
+ * =============================== */
+
+/*
+  Copy a snapshot of the kernel's performance counters into $stats. Returns the
+  number of bytes copied, or ERROR.
+*/
+
+int GetKernelStats(KernelStats *stats) {
+	return Custom2(CUSTOM_KERNEL_STATS, (int) (long) stats, sizeof(KernelStats), 0);
+}
+
+
+
+
+/*
+  Copy the latency histogram for the syscall $code (e.g. YALNIX_FORK, or
+  STATS_CUSTOM_LATENCY(CUSTOM_FUTEX_WAIT) for one Custom2 operation) into
+  $buckets, which needs room for STATS_LATENCY_BUCKETS entries.
+*/
+
+int GetSyscallLatency(int code, unsigned int *buckets) {
+	return Custom2(CUSTOM_SYSCALL_LATENCY, code, (int) (long) buckets, 0);
+}
+
+// Zero out every counter and histogram in the kernel
+int ResetKernelStats() {
+	return Custom2(CUSTOM_STATS_RESET, 0, 0, 0);
+}
+
+
+
+
+/*
+  Copy up to $count of the newest events from the kernel's trace ring into
+  $events, oldest first. Returns the number of events copied.
+*/
+
+int TraceRead(TraceEvent *events, int count) {
+	return Custom2(CUSTOM_TRACE_READ, (int) (long) events, count, 0);
+}
+
+// Only record the categories in $mask (see TRACE_* in custom.h). Returns the old mask.
+int TraceSetMask(unsigned int mask) {
+	return Custom2(CUSTOM_TRACE_MASK, mask, 0, 0);
+}
+
+
+
+
+// The number of clock ticks since the machine booted
+int GetClockTicks() {
+	return Custom2(CUSTOM_CLOCK_TICKS, 0, 0, 0);
+}
+
+
+
+
+/*
+  Copy the memory usage of the process $pid (or our own, if it's 0) into $usage.
+*/
+
+int GetMemoryUsage(int pid, MemoryUsage *usage) {
+	return Custom2(CUSTOM_MEMORY_USAGE, pid, (int) (long) usage, 0);
+}
+
+
+// Block until the kernel is running low on page frames. Returns how many are left.
+int WaitForMemoryPressure() {
+	return Custom2(CUSTOM_MEMORY_PRESSURE, 0, 0, 0);
+}
+
+
+
+
+/*
+  Make one in every $rate allocations at $sites (see FAULT_* in custom.h) fail,
+  chosen by a generator seeded with $seed. A rate of 0 turns it off again.
+*/
+
+int FaultInject(unsigned int sites, unsigned int rate, unsigned int seed) {
+	return Custom2(CUSTOM_FAULT_INJECT, sites, rate, seed);
+}
+
+
+// Have the kernel check its memory bookkeeping. Returns the number of problems it found.
+int CheckMemory() {
+	return Custom2(CUSTOM_MEMORY_CHECK, 0, 0, 0);
+}
@@ -0,0 +1,48 @@
+/*
+  File: stats.h
+  Date: 10/19/2026
+  Author: Mitchell Goff
+*/
+
+#ifndef __USER_STATS_H__
+#define __USER_STATS_H__
+
+
+
+/* =============================== *
+
+  			  Includes
+
+ * =============================== */
+
+#include "../include/hardware.h"
+#include "../include/yalnix.h"
+#include "../include/custom.h"
+
+
+
+
+
+/* =============================== *
+
+  		     Interface
+
+ * =============================== */
+
+int GetKernelStats(KernelStats *stats);
+int GetSyscallLatency(int code, unsigned int *buckets);
+int ResetKernelStats();
+
+int TraceRead(TraceEvent *events, int count);
+int TraceSetMask(unsigned int mask);
+
+int GetClockTicks();
+int GetMemoryUsage(int pid, MemoryUsage *usage);
+int WaitForMemoryPressure();
+
+int FaultInject(unsigned int sites, unsigned int rate, unsigned int seed);
+int CheckMemory();
+
+
+
+#endif
@@ -14,6 +14,7 @@
 
 #include "../include/hardware.h"
 #include "../include/yalnix.h"
+#include "../include/custom.h"
 
 #include "threads.h"
 
@@ -56,3 +57,24 @@ int CreateThread(ThreadEntry entry, void *entry_arg) {
 int JoinThread(int thread_id) {
 	return Custom1(thread_id, 0, 0, 0);
 }
+
+
+
+/*
+  Create a barrier for $participants threads
+*/
+
+int BarrierInit(int *barrier_id, int participants) {
+	return Custom2(CUSTOM_BARRIER_INIT, (int) (long) barrier_id, participants, 0);
+}
+
+
+
+/*
+  Wait for the rest of the threads to reach the barrier. Returns 1 in exactly one
+  of the threads each time the barrier opens.
+*/
+
+int BarrierWait(int barrier_id) {
+	return Custom2(CUSTOM_BARRIER_WAIT, barrier_id, 0, 0);
+}
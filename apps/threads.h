@@ -17,6 +17,7 @@
 
 #include "../include/hardware.h"
 #include "../include/yalnix.h"
+#include "../include/custom.h"
 
 
 
@@ -43,6 +44,9 @@ typedef void (*ThreadEntry) (void *);
 int CreateThread(ThreadEntry entry, void *entry_arg);
 int JoinThread(int thread_id);
 
+int BarrierInit(int *barrier_id, int participants);
+int BarrierWait(int barrier_id);
+
 
 
 #endif
@@ -0,0 +1,46 @@
+/*
+  File: timed.c
+  Date: 10/19/2026
+  Author: Mitchell Goff
+*/
+
+
+
+/* =============================== *
+
+  			  Includes
+
+ * =============================== */
+
+#include "../include/hardware.h"
+#include "../include/yalnix.h"
+#include "../include/custom.h"
+
+#include "timed.h"
+
+
+
+
+
+/* =============================== *
+
+  		   Implementation
+
+ * =============================== */
+
+/*
+  Each of these blocks for at most $ticks clock ticks, and returns TIMEOUT if
+  it had to give up. CvarWaitWithTimeout still holds the lock when it returns.
+*/
+
+int AcquireWithTimeout(int lock_id, int ticks) {
+	return Custom2(CUSTOM_LOCK_ACQUIRE_TIMED, lock_id, ticks, 0);
+}
+
+int CvarWaitWithTimeout(int cvar_id, int lock_id, int ticks) {
+	return Custom2(CUSTOM_CVAR_WAIT_TIMED, cvar_id, lock_id, ticks);
+}
+
+int TtyReadWithTimeout(int tty_id, void *buf, int len, int ticks) {
+	return Custom2(CUSTOM_TTY_READ_TIMED, packTtyTimeout(tty_id, ticks), (int) (long) buf, len);
+}
@@ -0,0 +1,38 @@
+/*
+  File: timed.h
+  Date: 10/19/2026
+  Author: Mitchell Goff
+*/
+
+#ifndef __USER_TIMED_H__
+#define __USER_TIMED_H__
+
+
+
+/* =============================== *
+
+  			  Includes
+
+ * =============================== */
+
+#include "../include/hardware.h"
+#include "../include/yalnix.h"
+#include "../include/custom.h"
+
+
+
+
+
+/* =============================== *
+
+  		     Interface
+
+ * =============================== */
+
+int AcquireWithTimeout(int lock_id, int ticks);
+int CvarWaitWithTimeout(int cvar_id, int lock_id, int ticks);
+int TtyReadWithTimeout(int tty_id, void *buf, int len, int ticks);
+
+
+
+#endif
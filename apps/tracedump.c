@@ -0,0 +1,60 @@
+/*
+  File: tracedump.c
+  Date: 10/19/2026
+  Author: Mitchell Goff
+*/
+
+
+
+/* =============================== *
+
+             Includes
+
+ * =============================== */
+
+#include "../include/hardware.h"
+#include "../include/yalnix.h"
+#include "../include/custom.h"
+
+#include "stats.h"
+#include "stats.c"
+
+
+
+
+
+/* =============================== *
+
+             Functions
+
+ * =============================== */
+
+/*
+  Dump the kernel's trace ring to the console, one event per line, in the format
+  that tools/tracedecode reads:
+
+    trace <sequence> <timestamp high> <timestamp low> <pid> <type> <arg 0> <arg 1>
+*/
+
+// The most events we'll ask for. Matches the default size of the ring.
+#define MAX_EVENTS 1024
+
+TraceEvent events[MAX_EVENTS];
+
+int main() {
+	int count = TraceRead(events, MAX_EVENTS);
+	if (count == ERROR) {
+		TtyPrintf(TTY_CONSOLE, "Couldn't read the trace ring\n");
+		Exit(ERROR);
+	}
+
+	for (int i=0; i<count; i++) {
+		TraceEvent *event = &events[i];
+		TtyPrintf(TTY_CONSOLE, "trace %x %x %x %x %x %x %x\n", event->sequence,
+			event->timestamp_high, event->timestamp_low, event->pid, event->type,
+			event->args[0], event->args[1]);
+	}
+
+	Exit(count);
+	return 0;
+}
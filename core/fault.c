@@ -0,0 +1,79 @@
+/*
+  File: fault.c
+  Date: 10/19/2026
+  Author: Mitchell Goff
+*/
+
+
+/* =============================== *
+
+             Includes
+
+ * =============================== */
+
+#include "../include/hardware.h"
+#include "fault.h"
+#include "stats.h"
+
+
+
+
+/* =============================== *
+
+               Data
+
+ * =============================== */
+
+unsigned int fault_sites = 0;
+
+// Fail one allocation in every $fault_rate, on average
+static unsigned int fault_rate = 0;
+
+// The state of the xorshift generator. It can never be zero.
+static unsigned int fault_state = 1;
+
+
+
+
+/* =============================== *
+
+           Implementation
+
+ * =============================== */
+
+/*
+  Decide whether an allocation at an armed site fails. The generator only moves
+  when an armed site asks, so a given seed fails the same allocations every time
+  the same workload runs.
+*/
+
+int shouldInjectFault(unsigned int site) {
+	fault_state ^= fault_state << 13;
+	fault_state ^= fault_state >> 17;
+	fault_state ^= fault_state << 5;
+	if (fault_state % fault_rate) return 0;
+
+	TracePrintf(2, "Injecting a fault at site %x\n", site);
+	countStat(faults_injected);
+	return 1;
+}
+
+
+
+
+/*
+  Start failing allocations at $sites, one in every $rate of them, with the
+  generator seeded from $seed. A rate of 0 stops injecting faults. Returns the
+  number of faults injected before this call.
+*/
+
+int setFaultInjection(unsigned int sites, unsigned int rate, unsigned int seed) {
+	int injected = kernel_stats.faults_injected;
+
+	fault_sites = rate ? sites & FAULT_ALL : 0;
+	fault_rate = rate;
+	fault_state = seed ? seed : 1;
+
+	TracePrintf(1, "Fault injection: sites %x, rate 1/%u, seed %u\n", fault_sites, rate, seed);
+	return injected;
+}
@@ -0,0 +1,82 @@
+/*
+  File: fault.h
+  Date: 10/19/2026
+  Author: Mitchell Goff
+*/
+
+#ifndef __YALNIX_FAULT_H__
+#define __YALNIX_FAULT_H__
+
+
+
+/* =============================== *
+
+  			  Includes
+
+ * =============================== */
+
+// This has to come before the malloc macro below, or it would mangle the declaration
+#include <stdlib.h>
+
+#include "../include/custom.h"
+
+
+
+
+
+/* =============================== *
+
+  		   Data Structures
+
+ * =============================== */
+
+/*
+  Fault injection makes allocatePageFrame and the kernel's malloc fail on purpose
+  (see CUSTOM_FAULT_INJECT in include/custom.h), so we can check that every caller
+  cleans up after itself. Like tracing, checking whether a site is armed is a
+  single mask test. It's compiled out unless FAULT_INJECTION is set to 1, which
+  the simulator build used by "make test" does.
+*/
+
+#ifndef FAULT_INJECTION
+#define FAULT_INJECTION 0
+#endif
+
+extern unsigned int fault_sites;
+
+
+
+
+
+/* =============================== *
+
+  		      Macros
+
+ * =============================== */
+
+// Whether the next allocation at $site should fail
+#if FAULT_INJECTION
+	#define injectFault(site) ((fault_sites & (site)) && shouldInjectFault(site))
+
+	// Every kernel file gets this through memory.h
+	#define malloc(size) (injectFault(FAULT_MALLOC) ? NULL : malloc(size))
+#else
+	#define injectFault(site) 0
+#endif
+
+
+
+
+
+/* =============================== *
+
+             Interface
+
+ * =============================== */
+
+int shouldInjectFault(unsigned int site);
+int setFaultInjection(unsigned int sites, unsigned int rate, unsigned int seed);
+
+
+
+#endif
@@ -82,13 +82,14 @@ static inline void removeNode(LinkedListNode *node) {
 	node->next->prev = node->prev;
 }
 
-// Splice list $second into list $first
+// Splice list $second onto the end of list $first. Afterwards, $second's head
+// still points into $first, so it needs to be reinitialized before it's reused.
 static inline void spliceLinkedLists(LinkedListNode *second, LinkedListNode *first) {
 	if (!listIsEmpty(second)) {
 		second->prev->next = first;
 		second->next->prev = first->prev;
-		first->prev->next = second->prev;
-		first->prev = second->next;
+		first->prev->next = second->next;
+		first->prev = second->prev;
 	}
 }
 
@@ -0,0 +1,104 @@
+/*
+  File: stats.c
+  Date: 10/19/2026
+  Author: Mitchell Goff
+*/
+
+
+/* =============================== *
+
+             Includes
+
+ * =============================== */
+
+#include <string.h>
+
+#include "../include/hardware.h"
+#include "../process/process.h"
+#include "stats.h"
+
+
+
+
+/* =============================== *
+
+               Data
+
+ * =============================== */
+
+KernelStats kernel_stats;
+
+// One log-bucketed latency histogram for each syscall number, followed by one
+// for each Custom2 operation
+static unsigned int syscall_latency[STATS_SYSCALLS + STATS_CUSTOM_OPS][STATS_LATENCY_BUCKETS];
+
+
+
+
+/* =============================== *
+
+           Implementation
+
+ * =============================== */
+
+/*
+  Copy a snapshot of the counters out to the current process. If $length is
+  shorter than the whole block, the user just gets the beginning of it. Returns
+  the number of bytes copied.
+*/
+
+int copyKernelStats(void *buffer, int length) {
+	if (length > (int) sizeof(KernelStats)) length = sizeof(KernelStats);
+	checkForError(prepareUserRange(getCurrentProcess(), buffer, length, 1));
+
+	kernel_stats.free_frames = free_frames;
+	memcpy(buffer, &kernel_stats, length);
+	return length;
+}
+
+
+
+
+// Find the histogram for $code, which is either a syscall or a STATS_CUSTOM_LATENCY
+static unsigned int* latencyHistogram(int code) {
+	unsigned int slot = (unsigned int) code;
+	if (slot < STATS_SYSCALLS || slot >= STATS_SYSCALLS + STATS_CUSTOM_OPS) slot %= STATS_SYSCALLS;
+	return syscall_latency[slot];
+}
+
+
+
+
+/*
+  Copy the latency histogram for the syscall with code $code, or for the Custom2
+  operation in STATS_CUSTOM_LATENCY(operation), out to the current process.
+  $buffer has to have room for STATS_LATENCY_BUCKETS unsigned ints.
+*/
+
+int copySyscallLatency(int code, void *buffer) {
+	unsigned int *histogram = latencyHistogram(code);
+	checkForError(prepareUserRange(getCurrentProcess(), buffer, sizeof(syscall_latency[0]), 1));
+
+	memcpy(buffer, histogram, sizeof(syscall_latency[0]));
+	return SUCCESS;
+}
+
+
+
+
+// Add a syscall (or Custom2 operation) that took $cycles to its histogram
+void recordSyscallLatency(int code, unsigned long long cycles) {
+	int bucket = cycles ? 63 - __builtin_clzll(cycles) : 0;
+	if (bucket >= STATS_LATENCY_BUCKETS) bucket = STATS_LATENCY_BUCKETS - 1;
+
+	latencyHistogram(code)[bucket]++;
+}
+
+
+
+
+// Zero out every counter and histogram
+void resetKernelStats() {
+	memset(&kernel_stats, 0x00, sizeof(kernel_stats));
+	memset(syscall_latency, 0x00, sizeof(syscall_latency));
+}
@@ -0,0 +1,104 @@
+/*
+  File: stats.h
+  Date: 10/19/2026
+  Author: Mitchell Goff
+*/
+
+#ifndef __YALNIX_STATS_H__
+#define __YALNIX_STATS_H__
+
+
+
+/* =============================== *
+
+  			  Includes
+
+ * =============================== */
+
+#include "../include/hardware.h"
+#include "../include/custom.h"
+
+
+
+
+
+/* =============================== *
+
+  		   Data Structures
+
+ * =============================== */
+
+/*
+  The kernel's performance counters (see include/custom.h). There's only the one
+  CPU, so a single block covers everything, and bumping a counter is just an
+  increment with no locking.
+*/
+
+extern KernelStats kernel_stats;
+
+
+
+
+
+/* =============================== *
+
+  		      Macros
+
+ * =============================== */
+
+// Bump one of the plain counters, or add $count to it
+#define countStat(field) (kernel_stats.field++)
+#define addStat(field, count) (kernel_stats.field += (count))
+
+#define countTrap(vector) \
+	(kernel_stats.traps[(unsigned int)(vector) % STATS_TRAPS]++)
+
+#define countSyscall(code) \
+	(kernel_stats.syscalls[(unsigned int)(code) % STATS_SYSCALLS]++)
+
+// Figure out what kind of flush a REG_TLB_FLUSH value is
+#define flushKind(what) \
+	((long)(what) == TLB_FLUSH_ALL ? STATS_FLUSH_ALL : \
+	 (long)(what) == TLB_FLUSH_0 ? STATS_FLUSH_REGION_0 : \
+	 (long)(what) == TLB_FLUSH_1 ? STATS_FLUSH_REGION_1 : STATS_FLUSH_PAGE)
+
+#define countTLBFlush(what) \
+	(kernel_stats.tlb_flushes[flushKind(what)]++)
+
+
+
+
+/*
+  Read the CPU's cycle counter. It's cheap enough to take at every syscall, unlike
+  anything that goes through the hardware.
+*/
+
+static inline unsigned long long readCycleCounter() {
+	#if defined(__i386__) || defined(__x86_64__)
+		unsigned int low, high;
+		__asm__ __volatile__ ("rdtsc" : "=a" (low), "=d" (high));
+		return ((unsigned long long) high << 32) | low;
+	#else
+		extern long elapsed_clock_ticks;
+		return elapsed_clock_ticks;
+	#endif
+}
+
+
+
+
+
+/* =============================== *
+
+             Interface
+
+ * =============================== */
+
+int copyKernelStats(void *buffer, int length);
+int copySyscallLatency(int code, void *buffer);
+void recordSyscallLatency(int code, unsigned long long cycles);
+void resetKernelStats();
+
+
+
+#endif
@@ -0,0 +1,99 @@
+/*
+  File: trace.c
+  Date: 10/19/2026
+  Author: Mitchell Goff
+*/
+
+
+/* =============================== *
+
+             Includes
+
+ * =============================== */
+
+#include <string.h>
+
+#include "../include/hardware.h"
+#include "../process/process.h"
+#include "stats.h"
+#include "trace.h"
+
+
+
+
+/* =============================== *
+
+               Data
+
+ * =============================== */
+
+unsigned int trace_mask = TRACE_DEFAULT_MASK;
+
+static TraceEvent trace_ring[TRACE_RING_SIZE];
+static unsigned int trace_head = 0;
+
+#define traceSlot(sequence) ((sequence) & (TRACE_RING_SIZE - 1))
+
+
+
+
+/* =============================== *
+
+           Implementation
+
+ * =============================== */
+
+/*
+  Add an event to the ring, overwriting the oldest one if it's full. There's no
+  locking, since nothing can interrupt the kernel part way through.
+*/
+
+void recordTraceEvent(unsigned int type, long a, long b) {
+	TraceEvent *event = &trace_ring[traceSlot(trace_head)];
+	unsigned long long now = readCycleCounter();
+	ProcessDescriptor *process = getCurrentProcess();
+
+	event->sequence = trace_head++;
+	event->timestamp_high = now >> 32;
+	event->timestamp_low = now;
+	event->pid = process ? process->pid : 0;
+	event->type = type;
+	event->args[0] = a;
+	event->args[1] = b;
+}
+
+
+
+
+/*
+  Copy up to $count of the newest events out to the current process, oldest
+  first. Returns the number of events copied.
+*/
+
+int copyTraceEvents(void *buffer, int count) {
+	if (count < 0) return ERROR;
+
+	unsigned int available = trace_head < TRACE_RING_SIZE ? trace_head : TRACE_RING_SIZE;
+	if ((unsigned int) count > available) count = available;
+	checkForError(prepareUserRange(getCurrentProcess(), buffer, count * sizeof(TraceEvent), 1));
+
+	// The events might wrap around the end of the ring, so copy them in two pieces
+	unsigned int first = traceSlot(trace_head - count);
+	unsigned int room = TRACE_RING_SIZE - first;
+	unsigned int before_wrap = room < (unsigned int) count ? room : (unsigned int) count;
+
+	memcpy(buffer, &trace_ring[first], before_wrap * sizeof(TraceEvent));
+	memcpy((TraceEvent *) buffer + before_wrap, trace_ring, (count - before_wrap) * sizeof(TraceEvent));
+
+	return count;
+}
+
+
+
+
+// Pick which categories get recorded, and return the old mask
+int setTraceMask(unsigned int mask) {
+	unsigned int old_mask = trace_mask;
+	trace_mask = mask & TRACE_ALL;
+	return old_mask;
+}
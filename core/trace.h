@@ -0,0 +1,90 @@
+/*
+  File: trace.h
+  Date: 10/19/2026
+  Author: Mitchell Goff
+*/
+
+#ifndef __YALNIX_TRACE_H__
+#define __YALNIX_TRACE_H__
+
+
+
+/* =============================== *
+
+  			  Includes
+
+ * =============================== */
+
+#include "../include/hardware.h"
+#include "../include/custom.h"
+
+
+
+
+
+/* =============================== *
+
+  		   Data Structures
+
+ * =============================== */
+
+/*
+  A fixed-size ring of binary trace events (see include/custom.h for the format).
+  Recording an event is a mask check and a handful of stores, so unlike TracePrintf
+  it can stay on in hot paths. Set TRACE_ENABLED to 0 to compile it out entirely.
+*/
+
+#ifndef TRACE_ENABLED
+#define TRACE_ENABLED 1
+#endif
+
+// Which categories get recorded from boot. The scheduler category counts the
+// runnable processes on every switch, so it's left off until someone asks for it.
+#ifndef TRACE_DEFAULT_MASK
+#define TRACE_DEFAULT_MASK ((1 << TRACE_MEMORY) | (1 << TRACE_TRAPS))
+#endif
+
+// How many events the ring holds. This has to be a power of two.
+#ifndef TRACE_RING_SIZE
+#define TRACE_RING_SIZE 1024
+#endif
+
+extern unsigned int trace_mask;
+
+
+
+
+
+/* =============================== *
+
+  		      Macros
+
+ * =============================== */
+
+// Record an event, if its category is enabled
+#if TRACE_ENABLED
+	#define traceEvent(type, a, b) \
+		do { \
+			if (trace_mask & (1 << traceCategory(type))) recordTraceEvent((type), (long)(a), (long)(b)); \
+		} while (0)
+#else
+	#define traceEvent(type, a, b) do { } while (0)
+#endif
+
+
+
+
+
+/* =============================== *
+
+             Interface
+
+ * =============================== */
+
+void recordTraceEvent(unsigned int type, long a, long b);
+int copyTraceEvents(void *buffer, int count);
+int setTraceMask(unsigned int mask);
+
+
+
+#endif
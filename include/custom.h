@@ -0,0 +1,272 @@
+/*
+  File: custom.h
+  Date: 10/19/2026
+  Author: Mitchell Goff
+*/
+
+#ifndef __YALNIX_CUSTOM_H__
+#define __YALNIX_CUSTOM_H__
+
+
+
+/* =============================== *
+
+  	           Macros
+
+ * =============================== */
+
+/*
+  Custom0 and Custom1 are CreateThread and JoinThread. Custom2 is a gate for any
+  extended syscalls we add on top of the standard Yalnix interface: the first
+  argument picks the operation, and the other three are passed through to it.
+  This header is shared between the kernel and the user libraries in apps/.
+*/
+
+#define CUSTOM_FUTEX_WAIT       0x01
+#define CUSTOM_FUTEX_WAKE       0x02
+
+#define CUSTOM_SEM_UP_N         0x10
+#define CUSTOM_SEM_DOWN_N       0x11
+#define CUSTOM_SEM_TRY_DOWN     0x12
+
+#define CUSTOM_RWLOCK_INIT      0x20
+#define CUSTOM_RWLOCK_READ      0x21
+#define CUSTOM_RWLOCK_WRITE     0x22
+#define CUSTOM_RWLOCK_UNLOCK    0x23
+
+#define CUSTOM_BARRIER_INIT     0x30
+#define CUSTOM_BARRIER_WAIT     0x31
+
+#define CUSTOM_LOCK_ACQUIRE_TIMED 0x40
+#define CUSTOM_CVAR_WAIT_TIMED  0x41
+#define CUSTOM_TTY_READ_TIMED   0x42
+
+#define CUSTOM_KERNEL_STATS     0x50
+#define CUSTOM_SYSCALL_LATENCY  0x51
+#define CUSTOM_STATS_RESET      0x52
+#define CUSTOM_TRACE_READ       0x53
+#define CUSTOM_TRACE_MASK       0x54
+#define CUSTOM_CLOCK_TICKS      0x55
+#define CUSTOM_MEMORY_USAGE     0x56
+#define CUSTOM_MEMORY_PRESSURE  0x57
+#define CUSTOM_FAULT_INJECT     0x58
+#define CUSTOM_MEMORY_CHECK     0x59
+
+
+
+
+/*
+  The timed calls take a timeout in clock ticks and return TIMEOUT if it runs out
+  before they're woken up. TtyRead already needs three arguments, so its terminal
+  and timeout get packed into one.
+*/
+
+#define TIMEOUT (-3)
+
+#define packTtyTimeout(tty, ticks) (((ticks) << 8) | ((tty) & 0xFF))
+#define ttyOfPackedTimeout(packed) ((packed) & 0xFF)
+#define ticksOfPackedTimeout(packed) ((packed) >> 8)
+
+
+
+
+
+/*
+  A snapshot of the kernel's performance counters, as copied out by
+  CUSTOM_KERNEL_STATS. Every counter starts at zero when the kernel boots, and
+  goes back to zero on CUSTOM_STATS_RESET.
+
+  traps:            Traps taken, indexed by vector
+  syscalls:         Syscalls made, indexed by the low byte of the syscall code
+  frames_*:         Page frames handed out by / given back to the frame allocator
+  cow_copies:       Copy-on-write breaks that had to copy the page
+  cow_reowns:       Copy-on-write breaks where we were the last sharer
+  tlb_flushes:      TLB flushes, indexed by the STATS_FLUSH_* kind
+  context_switches: Kernel context switches between two processes
+  waitqueue_sleeps: Times a process blocked on a waitqueue
+  free_frames:      Page frames on the free list right now (this one isn't reset)
+  pressure_events:  Times the free frames dropped below the low watermark
+  oom_kills:        Processes killed by the out-of-memory killer
+  faults_injected:  Allocations failed on purpose by CUSTOM_FAULT_INJECT
+  memory_checks:    Runs of the memory checker, from CUSTOM_MEMORY_CHECK or the clock
+*/
+
+#define STATS_TRAPS             16  // TRAP_VECTOR_SIZE
+#define STATS_SYSCALLS          256
+
+#define STATS_FLUSH_ALL         0
+#define STATS_FLUSH_REGION_0    1
+#define STATS_FLUSH_REGION_1    2
+#define STATS_FLUSH_PAGE        3
+#define STATS_FLUSH_KINDS       4
+
+struct KernelStats {
+    unsigned long traps[STATS_TRAPS];
+    unsigned long syscalls[STATS_SYSCALLS];
+    unsigned long frames_allocated;
+    unsigned long frames_freed;
+    unsigned long cow_copies;
+    unsigned long cow_reowns;
+    unsigned long tlb_flushes[STATS_FLUSH_KINDS];
+    unsigned long context_switches;
+    unsigned long waitqueue_sleeps;
+    unsigned long free_frames;
+    unsigned long pressure_events;
+    unsigned long oom_kills;
+    unsigned long faults_injected;
+    unsigned long memory_checks;
+};
+
+typedef struct KernelStats KernelStats;
+
+
+
+
+/*
+  CUSTOM_SYSCALL_LATENCY copies out the latency histogram for one syscall, measured
+  in CPU cycles from the moment trapKernel picks it up to the moment it returns to
+  the caller (so a blocking call includes the time it spent asleep). Bucket i
+  counts the calls that took [2^i, 2^(i+1)) cycles, and the last bucket also
+  takes everything slower than that. Custom2 calls also get a histogram for each
+  operation: pass STATS_CUSTOM_LATENCY(CUSTOM_FUTEX_WAIT), say, for just that
+  operation, or YALNIX_CUSTOM_2 for all of them together.
+*/
+
+#define STATS_LATENCY_BUCKETS   24
+#define STATS_CUSTOM_OPS        256
+
+#define STATS_CUSTOM_LATENCY(operation) \
+    (STATS_SYSCALLS + ((unsigned int) (operation) % STATS_CUSTOM_OPS))
+
+
+
+
+/*
+  The kernel keeps a ring of the most recent trace events. CUSTOM_TRACE_READ copies
+  the newest ones out (oldest first), and CUSTOM_TRACE_MASK picks which categories
+  get recorded (scheduler events are off until a mask turns them on). Every field
+  is 32 bits wide, so the layout is the same for the kernel, user programs and the
+  host-side decoder in tools/.
+
+  sequence:   Counts every event ever recorded, so gaps show where the ring wrapped
+  timestamp:  CPU cycle counter when the event was recorded
+  pid:        The process that was running, or 0 while the kernel boots
+  type:       One of the TRACE_* types below. The high byte is the category.
+  args:       Event-specific arguments
+*/
+
+#define TRACE_MEMORY            0
+#define TRACE_TRAPS             1
+#define TRACE_SCHEDULER         2
+#define TRACE_CATEGORIES        3
+
+#define TRACE_ALL               ((1 << TRACE_CATEGORIES) - 1)
+#define traceCategory(type)     ((type) >> 8)
+
+#define TRACE_FRAME_ALLOC       0x0001  // frame
+#define TRACE_FRAME_FREE        0x0002  // frame
+#define TRACE_FRAME_FREE_BATCH  0x0003  // number of frames released
+#define TRACE_BRK_GROW          0x0004  // pages, new brk
+#define TRACE_BRK_SHRINK        0x0005  // pages, new brk
+#define TRACE_KERNEL_BRK        0x0006  // new kernel brk
+#define TRACE_MEMORY_PRESSURE   0x0007  // free frames
+#define TRACE_OOM_KILL          0x0008  // victim pid, resident pages
+
+#define TRACE_CLOCK             0x0100  // clock tick
+#define TRACE_DISK              0x0101
+#define TRACE_SYSCALL_ENTER     0x0102  // syscall code
+#define TRACE_SYSCALL_EXIT      0x0103  // syscall code, result
+
+#define TRACE_SWITCH            0x0200  // next pid, reason | runnable processes << 8
+#define TRACE_SLEEP             0x0201  // waitqueue (0 while waiting for a message)
+#define TRACE_WAKEUP            0x0202  // woken pid
+#define TRACE_RUN_LATENCY       0x0203  // pid, cycles from its wakeup until it ran
+
+// Why the process in a TRACE_SWITCH event stopped running
+#define TRACE_SWITCH_TICK       0       // its time slice ran out
+#define TRACE_SWITCH_BLOCK      1       // it went to sleep (see the TRACE_SLEEP before it)
+#define TRACE_SWITCH_DELAY      2       // it called Delay
+#define TRACE_SWITCH_EXIT       3       // it exited
+
+struct TraceEvent {
+    unsigned int sequence;
+    unsigned int timestamp_high;
+    unsigned int timestamp_low;
+    unsigned int pid;
+    unsigned int type;
+    unsigned int args[2];
+};
+
+typedef struct TraceEvent TraceEvent;
+
+
+
+
+/*
+  CUSTOM_MEMORY_USAGE copies out how much memory a process (or the caller, if the
+  PID is 0) is using. Everything is counted in pages of its REGION_1.
+
+  resident:    Pages that are mapped to a frame
+  shared:      Resident pages whose frame is also mapped somewhere else (by another
+               process, a thread or a pipe)
+  cow_pending: Pages still marked copy-on-write, so the next write will fault
+  heap:        Resident pages in the heap
+  stack:       Resident pages in the stack
+*/
+
+struct MemoryUsage {
+    unsigned int resident;
+    unsigned int shared;
+    unsigned int cow_pending;
+    unsigned int heap;
+    unsigned int stack;
+};
+
+typedef struct MemoryUsage MemoryUsage;
+
+
+
+
+/*
+  CUSTOM_MEMORY_PRESSURE blocks until the number of free page frames drops below
+  the kernel's low watermark (or returns right away if it already has), and
+  returns the number of free frames. Processes can use it to give memory back
+  before the out-of-memory killer has to step in. Whatever the killer picks
+  exits with EXIT_OUT_OF_MEMORY.
+*/
+
+#define EXIT_OUT_OF_MEMORY (-4)
+
+
+
+
+/*
+  CUSTOM_FAULT_INJECT makes the kernel's allocators fail on purpose, so the error
+  paths behind them get exercised. Each allocation at one of the chosen sites
+  fails with probability 1/rate, decided by a pseudo-random generator started
+  from the given seed, so the same seed and workload fail the same allocations
+  every time. A rate of 0 turns injection off. Returns the faults_injected
+  counter from before the call, or ERROR if the kernel was built without
+  FAULT_INJECTION.
+*/
+
+#define FAULT_FRAME             0x01  // allocatePageFrame
+#define FAULT_MALLOC            0x02  // the kernel's malloc
+#define FAULT_ALL               0x03
+
+
+
+
+/*
+  CUSTOM_MEMORY_CHECK runs the kernel's memory checker: it rebuilds every frame's
+  reference count from the page tables, kernel stacks and pipes, checks that the
+  free list and the frames in use cover physical memory exactly once, and that
+  no page is both writable and copy-on-write (or writable and shared outside a
+  thread group). Every problem gets logged, and the call returns how many it
+  found, so 0 means everything is consistent, or ERROR if the kernel was built
+  without MEMORY_CHECK.
+*/
+
+
+
+#endif
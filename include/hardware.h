@@ -236,8 +236,13 @@ struct pte {
   #define REG_EDI EDI
   #define REG_EIP EIP
   #define REG_ESP ESP
-  #define REG_ERR ERR
-  #define REG_TRAPNO TRAPNO
+  // ... and some define these two even so
+  #ifndef REG_ERR
+    #define REG_ERR ERR
+  #endif
+  #ifndef REG_TRAPNO
+    #define REG_TRAPNO TRAPNO
+  #endif
   #define REG_EBP EBP
 #endif
 
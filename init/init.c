@@ -147,6 +147,9 @@ void SetKernelData(void *kernel_data_start, void *kernel_data_end) {
 
 void KernelStart(char *cmd_args[], unsigned int pmem_size, UserContext *context) {
 	TracePrintf(1, "Called KernelStart\n");
+
+	// Nothing is running until loadInit sets up the first process
+	((ProcessInfo *) KERNEL_STACK_BASE)->descriptor = 0;
 	
 	// Build the interrupt vector and set the REG_VECTOR_BASE register to point to it
 	WriteRegister(REG_VECTOR_BASE, (long)interrupt_vector);
@@ -187,6 +190,9 @@ void KernelStart(char *cmd_args[], unsigned int pmem_size, UserContext *context)
 		ttys[i].read_buffer_position = 0;
 	}
 
+	// Initialize the waitqueues for user space futexes
+	futexInit();
+
 	// Start the init process
 	loadInit(context, cmd_args);
 }
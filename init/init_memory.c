@@ -54,6 +54,7 @@ void initFrameList() {
 	for (long i = indexOfPage(KERNEL_BRK); i < indexOfPage(PMEM_SIZE); i++) {
 		LinkedListNode *node = (LinkedListNode *) (PMEM_BASE + (long)pageAtIndex(i));
 		if (i >= indexOfPage(KERNEL_STACK_BASE) && i < indexOfPage(KERNEL_STACK_LIMIT)) continue;
+		free_frames++;
 
 		// If this node is right before or right after the stack, we have to do some special trickery
 		if (i == indexOfPage(KERNEL_STACK_BASE) - 1) {
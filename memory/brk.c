@@ -26,6 +26,37 @@
 
  * =============================== */
 
+/*
+  Unmap $count heap pages starting at $address, giving their frames back, and
+  pull the end of the heap back to $address
+*/
+
+static void unmapHeapPages(long address, long count) {
+	ProcessDescriptor *process = getCurrentProcess();
+	MemoryUsage *usage = &process->memory;
+
+	for (int i=0; i<count; i++) {
+		// Figure out which physical frame to free
+		long pte_index = indexOfPage(address - VMEM_1_BASE) + i;
+		PTE entry = process->page_table->entries[pte_index];
+		void *frame = pageAtIndex(entry.pfn);
+
+		// Free the frame and clear the PTE
+		freePageFrame(frame);
+		process->page_table->entries[pte_index] = createPTEWithOptions(0, 0);
+		flushTLB(address + PAGESIZE*i);
+
+		usage->resident--;
+		usage->heap--;
+		if ((entry.misc << 4) & PTE_COPY_ON_WRITE) usage->cow_pending--;
+	}
+
+	process->mapped_ranges[RANGE_HEAP].end = indexOfPage(address - VMEM_1_BASE);
+}
+
+
+
+
 /*
   If we're increasing the size of the heap, allocate some new page frames
   and set the page table entries for the heap to point to them
@@ -36,13 +67,23 @@ static int increaseBrk(void *address) {
 	long current_brk = (long)((ProcessInfo *) KERNEL_STACK_BASE)->current_brk;
 	long frames_needed = (UP_TO_PAGE(address) - current_brk) >> PAGESHIFT;
 
-	TracePrintf(2, "Increasing the user heap for process %d by %d pages\n",
-		getCurrentProcess()->pid, frames_needed);
+	traceEvent(TRACE_BRK_GROW, frames_needed, UP_TO_PAGE(address));
+
+	// Leave the kernel's reserve alone, so malloc() fails before anything has to be killed
+	if (!userFramesAvailable(frames_needed)) {
+		TracePrintf(1, "Not enough free frames to grow the heap by %ld pages\n", frames_needed);
+		return ERROR;
+	}
 
 	for (int i=0; i<frames_needed; i++) {
-		// Allocate a new physical page frame, then create a PTE for it
+		// Allocate a new physical page frame, then create a PTE for it. If we run
+		// out part way through, the heap goes back to the way it was.
 		void *frame = allocatePageFrame();
-		errorIfNull(frame, "There aren't any page frames left for the heap :(\n");
+		if (!frame) {
+			TracePrintf(1, "There aren't any page frames left for the heap :(\n");
+			unmapHeapPages(current_brk, i);
+			return ERROR;
+		}
 
 		long options = PTE_VALID | PTE_PERM_READ | PTE_PERM_WRITE;
 		PTE entry = createPTEWithOptions(options, indexOfPage(frame));
@@ -50,7 +91,10 @@ static int increaseBrk(void *address) {
 		// Insert the new PTE into the page table
 		long index = indexOfPage(current_brk - VMEM_1_BASE) + i;
 		getCurrentProcess()->page_table->entries[index] = entry;
-		WriteRegister(REG_TLB_FLUSH, UP_TO_PAGE(current_brk) + PAGESIZE*i);
+		getCurrentProcess()->mapped_ranges[RANGE_HEAP].end = index + 1;
+		flushTLB(UP_TO_PAGE(current_brk) + PAGESIZE*i);
+		getCurrentProcess()->memory.resident++;
+		getCurrentProcess()->memory.heap++;
 	}
 
 	return 0;
@@ -70,21 +114,9 @@ static int decreaseBrk(void *address) {
 	long current_brk = (long)((ProcessInfo *) KERNEL_STACK_BASE)->current_brk;
 	long frames_freed = (current_brk - UP_TO_PAGE(address)) >> PAGESHIFT;
 
-	TracePrintf(2, "Decreasing the user heap for process %d by %d pages\n",
-		getCurrentProcess()->pid, frames_freed);
-
-	for (int i=0; i<frames_freed; i++) {
-		// Figure out which physical frame to free
-		long pte_index = indexOfPage(UP_TO_PAGE(address) - VMEM_1_BASE) + i;
-		long frame_index = getCurrentProcess()->page_table->entries[pte_index].pfn;
-		void *frame = pageAtIndex(frame_index);
-
-		// Free the frame and clear the PTE
-		freePageFrame(frame);
-		getCurrentProcess()->page_table->entries[pte_index] = createPTEWithOptions(0, 0);
-		WriteRegister(REG_TLB_FLUSH, UP_TO_PAGE(address) + PAGESIZE*i);
-	}
+	traceEvent(TRACE_BRK_SHRINK, frames_freed, UP_TO_PAGE(address));
 
+	unmapHeapPages(UP_TO_PAGE(address), frames_freed);
 	return 0;
 }
 
@@ -117,7 +149,6 @@ int setProcessBrk(void *address) {
 	checkForError(status);
 
 	((ProcessInfo *) KERNEL_STACK_BASE)->current_brk = (void *) UP_TO_PAGE(address);
-	TracePrintf(2, "Changed the current brk to %lX\n", (void *) UP_TO_PAGE(address));
 
 	return 0;
 }
@@ -0,0 +1,275 @@
+/*
+  File: check.c
+  Date: 10/19/2026
+  Author: Mitchell Goff
+*/
+
+
+
+/* =============================== *
+
+  	         Includes
+
+ * =============================== */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "../core/list.h"
+#include "../process/process.h"
+#include "../sync/sync.h"
+#include "../traps/traps.h"
+#include "memory.h"
+
+// The whole checker is compiled out of kernels built without MEMORY_CHECK
+#if MEMORY_CHECK
+
+
+
+
+/* =============================== *
+
+  	           Data
+
+ * =============================== */
+
+/*
+  The memory checker rebuilds the frame reference counts from scratch, from
+  everything that can hold on to a frame: the kernel page table, every live
+  process's page table and kernel stack, the kernel stack pool and the pipes. It
+  keeps one count per frame, with ON_FREE_LIST set on frames it found on the
+  free list.
+*/
+
+#define ON_FREE_LIST 0x8000
+
+static unsigned short *references = 0;
+static long violations;
+
+#define frameCount() indexOfPage(PMEM_SIZE)
+
+// Log a broken invariant, up to a point, and count it
+#define violation(...) \
+	do { \
+		if (violations++ < MEMORY_CHECK_REPORT_LIMIT) TracePrintf(0, "Memory check: " __VA_ARGS__); \
+	} while (0)
+
+
+
+
+
+/* =============================== *
+
+  	          Checks
+
+ * =============================== */
+
+/*
+  Walk the free list, marking every frame on it. Each one should be a real frame
+  that nobody holds a reference to, and appear exactly once with its links intact.
+*/
+
+static void checkFreeList() {
+	long options = PTE_VALID | PTE_PERM_READ | PTE_PERM_WRITE;
+	LinkedListNode *prev = &frame_head;
+	long count = 0;
+
+	for (LinkedListNode *node = frame_head.next; node != &frame_head; count++) {
+		long pfn = indexOfPage(node);
+
+		if (pfn >= frameCount() || (long) node & PAGEOFFSET) {
+			violation("free list points at %lX, which isn't a frame\n", (long) node);
+			return;
+		}
+		if (references[pfn] & ON_FREE_LIST) {
+			violation("frame %lX is on the free list twice\n", pfn);
+			return;
+		}
+		if (frc_table[pfn] != 0) violation("free frame %lX has a reference count of %d\n", pfn, frc_table[pfn]);
+
+		references[pfn] |= ON_FREE_LIST;
+
+		frame_window_pte(0) = createPTEWithOptions(options, pfn);
+		LinkedListNode *frame = (LinkedListNode *) frame_window(0);
+		if (frame->prev != prev) violation("free frame %lX doesn't point back at %lX\n", pfn, (long) prev);
+
+		prev = node;
+		node = frame->next;
+	}
+
+	if (frame_head.prev != prev) violation("the free list's tail is %lX, not %lX\n", (long) frame_head.prev, (long) prev);
+	if (count != free_frames) violation("%ld frames on the free list, but free_frames is %ld\n", count, free_frames);
+}
+
+
+
+
+/*
+  Count the references from a process's user page table, and make sure its
+  mappings agree with its segments, its memory counters and the copy-on-write
+  rules: a page is never both writable and copy-on-write, and a writable page is
+  only shared within a thread group, since everybody else has to go through
+  copy-on-write to share it.
+*/
+
+static void checkProcess(ProcessDescriptor *process) {
+	MemoryUsage usage = {0, 0, 0, 0, 0};
+	int in_thread_group = process->thread_leader || !listIsEmpty(&process->thread_group);
+
+	for (int i=0; i<indexOfPage(KERNEL_STACK_MAXSIZE); i++) {
+		references[indexOfPage(process->pcb_frames[i])]++;
+	}
+
+	for (long i=0; i<MAX_PT_LEN; i++) {
+		PTE entry = process->page_table->entries[i];
+		if (!entry.valid) continue;
+
+		if (entry.pfn >= frameCount()) {
+			violation("process %d maps page %lX to frame %lX, which doesn't exist\n", process->pid, i,
+				(long) entry.pfn);
+			continue;
+		}
+		references[entry.pfn]++;
+
+		// Figure out which segment the page belongs to
+		int range = 0;
+		while (range < NUMBER_OF_MAPPED_RANGES &&
+			(i < process->mapped_ranges[range].start || i >= process->mapped_ranges[range].end)) range++;
+		if (range == NUMBER_OF_MAPPED_RANGES) {
+			violation("process %d maps page %lX outside of its segments\n", process->pid, i);
+		}
+
+		long options = (entry.perm << 1) | (entry.misc << 4);
+		if ((options & PTE_PERM_WRITE) && (options & PTE_COPY_ON_WRITE)) {
+			violation("process %d's page %lX is writable and copy-on-write\n", process->pid, i);
+		}
+		if ((options & PTE_PERM_WRITE) && frc_table[entry.pfn] > 1 && !in_thread_group) {
+			violation("process %d's page %lX is writable, but frame %lX is shared\n", process->pid, i,
+				(long) entry.pfn);
+		}
+
+		usage.resident++;
+		if (options & PTE_COPY_ON_WRITE) usage.cow_pending++;
+		if (range == RANGE_HEAP) usage.heap++;
+		if (range == RANGE_STACK) usage.stack++;
+	}
+
+	MemoryUsage *counted = &process->memory;
+	if (counted->resident != usage.resident || counted->cow_pending != usage.cow_pending ||
+		counted->heap != usage.heap || counted->stack != usage.stack) {
+		violation("process %d counts %u/%u/%u/%u resident/cow/heap/stack pages, but maps %u/%u/%u/%u\n",
+			process->pid, counted->resident, counted->cow_pending, counted->heap, counted->stack,
+			usage.resident, usage.cow_pending, usage.heap, usage.stack);
+	}
+}
+
+
+
+
+/*
+  Count the references from the kernel page table. The frame windows and the
+  kernel stack are left out: the windows are only borrowed, and the stack is the
+  current process's, which gets counted along with the process.
+*/
+
+static void checkKernelPageTable() {
+	for (long i=0; i<frame_window_pte_base; i++) {
+		PTE entry = kernel_page_table.entries[i];
+		if (!entry.valid) continue;
+
+		if (entry.pfn >= frameCount()) {
+			violation("the kernel maps page %lX to frame %lX, which doesn't exist\n", i, (long) entry.pfn);
+			continue;
+		}
+		references[entry.pfn]++;
+	}
+}
+
+
+
+
+/*
+  Every frame should either be on the free list, or have exactly as many
+  references as the reference count table says it does.
+*/
+
+static void checkReferenceCounts() {
+	for (long pfn=0; pfn<frameCount(); pfn++) {
+		unsigned short counted = references[pfn] & ~ON_FREE_LIST;
+
+		if (references[pfn] & ON_FREE_LIST) {
+			if (counted) violation("frame %lX is on the free list, but has %u references\n", pfn, counted);
+		}
+		else if (counted == 0) {
+			violation("frame %lX isn't free, but nobody is using it\n", pfn);
+		}
+		else if (counted != frc_table[pfn]) {
+			violation("frame %lX has a reference count of %d, but %u references\n", pfn, frc_table[pfn], counted);
+		}
+	}
+}
+
+
+
+
+
+/* =============================== *
+
+  	       Implementation
+
+ * =============================== */
+
+/*
+  Check that the frame allocator, the reference counts and every page table
+  agree with each other. This walks all of physical memory, so it's only meant
+  for debugging. Returns the number of broken invariants it found (each gets
+  logged, up to MEMORY_CHECK_REPORT_LIMIT of them), or ERROR if it couldn't
+  get the memory to run.
+*/
+
+int checkMemoryInvariants() {
+	if (!references) references = (unsigned short *) malloc(frameCount() * sizeof(unsigned short));
+	errorIfNull(references, "There's not enough space to check memory\n");
+
+	memset(references, 0x00, frameCount() * sizeof(unsigned short));
+	violations = 0;
+
+	checkFreeList();
+	checkKernelPageTable();
+
+	ProcessDescriptor *process;
+	forEachElement(process, &process_head, process_list) {
+		if (process->state == PROCESS_ZOMBIE || process->state == PROCESS_DEAD) continue;
+		checkProcess(process);
+	}
+
+	countPooledStackFrames(references);
+	countPipeFrames(references);
+	checkReferenceCounts();
+
+	countStat(memory_checks);
+	if (violations > MEMORY_CHECK_REPORT_LIMIT) {
+		TracePrintf(0, "Memory check: %ld more problems not shown\n", violations - MEMORY_CHECK_REPORT_LIMIT);
+	}
+
+	return violations;
+}
+
+
+
+
+/*
+  Called on every clock tick. Every MEMORY_CHECK_INTERVAL ticks, check memory and
+  halt if anything is broken, so we stop as close to the cause as we can.
+*/
+
+void checkMemoryPeriodically() {
+	if (!MEMORY_CHECK_INTERVAL || elapsed_clock_ticks % MEMORY_CHECK_INTERVAL) return;
+
+	if (checkMemoryInvariants() > 0) {
+		TracePrintf(0, "Memory check failed on tick %ld, halting\n", elapsed_clock_ticks);
+		Halt();
+	}
+}
+
+#endif
@@ -32,6 +32,13 @@ void *KERNEL_BRK = 0;
 long PMEM_SIZE = 0;
 char *frc_table = NULL;
 
+long free_frames = 0;
+int memory_pressure = 0;
+
+// How many times we've dropped below the low watermark. Unlike the stats, this is
+// never reset, so oom.c can tell when there's a new drop to report.
+unsigned long pressure_episodes = 0;
+
 LinkedListNode frame_head = linkedListNode(frame_head);
 PageTable kernel_page_table;
 
@@ -68,6 +75,52 @@ void clearPageTable(PageTable *table) {
 
 
 
+/*
+  Give a process its own copy of a copy-on-write page. If nobody else is sharing
+  the frame anymore, we can just unset the copy-on-write bit. This works on any
+  process, not just the current one, since the copy goes through the frame
+  windows.
+*/
+
+int breakCopyOnWrite(ProcessDescriptor *process, long index) {
+    PageTable *table = process->page_table;
+    PTE old_entry = table->entries[index];
+    long options = PTE_VALID | (old_entry.perm << 1) | (old_entry.misc << 4);
+    if (!(options & PTE_COPY_ON_WRITE)) return SUCCESS;
+
+    options = (options & ~PTE_COPY_ON_WRITE) | PTE_PERM_WRITE;
+
+    // If there are more than once processes sharing this page...
+    if (frc_table[old_entry.pfn] > 1) {
+
+        // Allocate a new frame, then copy the old page to it
+        void *frame = allocatePageFrame();
+        errorIfNull(frame, "Couldn't allocate a frame to break copy-on-write\n");
+        frc_table[old_entry.pfn] -= 1;
+
+        long frame_window_options = PTE_VALID | PTE_PERM_READ | PTE_PERM_WRITE;
+        frame_window_pte(0) = createPTEWithOptions(frame_window_options, indexOfPage(frame));
+        frame_window_pte(1) = createPTEWithOptions(frame_window_options, old_entry.pfn);
+        memcpy(frame_window(0), frame_window(1), PAGESIZE);
+
+        table->entries[index] = createPTEWithOptions(options, indexOfPage(frame));
+        countStat(cow_copies);
+    }
+
+    // Otherwise, we can just unset the copy-on-write bit.
+    else {
+        table->entries[index] = createPTEWithOptions(options, old_entry.pfn);
+        countStat(cow_reowns);
+    }
+
+    process->memory.cow_pending--;
+    return SUCCESS;
+}
+
+
+
+
+
 /* =============================== *
 
   	    Memory Trap Handler
@@ -75,40 +128,18 @@ void clearPageTable(PageTable *table) {
  * =============================== */
 
 void handleMemoryTrap(void *address) {
+    ProcessDescriptor *process = getCurrentProcess();
     int index = indexOfPage(DOWN_TO_PAGE(address) - VMEM_1_BASE);
-    PTE old_entry = getCurrentProcess()->page_table->entries[index];
-    UserContext *context = &getCurrentProcess()->user_context;
+    PTE old_entry = process->page_table->entries[index];
+    UserContext *context = &process->user_context;
 
-    // If the user is trying to write to a copy-on-write page...
+    // If the user is trying to write to a copy-on-write page... We only need a new
+    // frame if someone else is still sharing this one. If we can't get one, the
+    // out-of-memory killer takes us instead, rather than the whole machine.
     if ((old_entry.misc << 4) & PTE_COPY_ON_WRITE) {
-
-        long options = PTE_VALID | (old_entry.perm << 1) | (old_entry.misc << 4);
-
-        // If there are more than once processes sharing this page...
-        if (frc_table[old_entry.pfn] > 1) {
-            
-        	// Decrement the frc and allocate a new frame
-            frc_table[old_entry.pfn] -= 1;
-            void *frame = allocatePageFrame();
-            haltIfNull(frame, "We're out of page frames!\n");
-
-            // Copy the old page to the new one
-            long frame_window_options = PTE_VALID | PTE_PERM_READ | PTE_PERM_WRITE;
-            frame_window_pte(0) = createPTEWithOptions(frame_window_options, indexOfPage(frame));
-            memcpy(frame_window(0), (void *) DOWN_TO_PAGE(address), PAGESIZE);
-
-            // Update the page table
-            options = (options & ~PTE_COPY_ON_WRITE) | PTE_PERM_WRITE;
-            PTE entry = createPTEWithOptions(options, indexOfPage(frame));
-            getCurrentProcess()->page_table->entries[index] = entry;
-        }
-
-
-        // Otherwise, we can just unset the copy-on-write bit.
-        else {
-            options = (options & ~PTE_COPY_ON_WRITE) | PTE_PERM_WRITE;
-            PTE entry = createPTEWithOptions(options, old_entry.pfn);
-            getCurrentProcess()->page_table->entries[index] = entry;
+        long frames_needed = frc_table[old_entry.pfn] > 1 ? 1 : 0;
+        if (reclaimUserFrames(frames_needed) == ERROR || breakCopyOnWrite(process, index) == ERROR) {
+            killForMemory(process);
         }
     }
 
@@ -117,16 +148,23 @@ void handleMemoryTrap(void *address) {
     // If the user is allocating more space for the stack...
     else if (DOWN_TO_PAGE(context->sp) <= (long)address) {
     	// Allocate a new frame
+        if (reclaimUserFrames(1) == ERROR) killForMemory(process);
         void *frame = allocatePageFrame();
-        haltIfNull(frame, "Couldn't find any more physical pages\n");
+        if (!frame) killForMemory(process);
 
         // Update the page table
         long options = PTE_VALID | PTE_PERM_READ | PTE_PERM_WRITE;
         PTE entry = createPTEWithOptions(options, indexOfPage(frame));
-        getCurrentProcess()->page_table->entries[index] = entry;
+        process->page_table->entries[index] = entry;
+
+        // And keep track of how far the stack extends
+        MappedRange *stack = &process->mapped_ranges[RANGE_STACK];
+        if (index < stack->start) stack->start = index;
+        process->memory.resident++;
+        process->memory.stack++;
     }
 
-    WriteRegister(REG_TLB_FLUSH, TLB_FLUSH_1);
+    flushTLB(TLB_FLUSH_1);
 }
 
 
@@ -148,7 +186,8 @@ void handleMemoryTrap(void *address) {
 
 void* allocatePageFrame() {
 
-	TracePrintf(2, "Allocating a page frame...\n");
+	// Pretend we've run out, if fault injection says so
+	if (injectFault(FAULT_FRAME)) return 0;
 
 	// Check if there are any page frames left.
 	if (frame_head.next == &frame_head) {
@@ -178,7 +217,17 @@ void* allocatePageFrame() {
 		((LinkedListNode *) frame_window(1))->prev = &frame_head;
 	}
 
-	TracePrintf(2, "Allocated a page frame at %lX\n", (long)frame);
+	traceEvent(TRACE_FRAME_ALLOC, frame, 0);
+	countStat(frames_allocated);
+
+	// Note when we first drop below the low watermark. Waiters get woken up on the
+	// next clock tick, since we might be in the middle of malloc() right now.
+	if (--free_frames < FRAMES_LOW_WATERMARK && !memory_pressure) {
+		memory_pressure = 1;
+		pressure_episodes++;
+		countStat(pressure_events);
+		traceEvent(TRACE_MEMORY_PRESSURE, free_frames, 0);
+	}
 
 	return frame;
 }
@@ -186,6 +235,15 @@ void* allocatePageFrame() {
 
 
 
+// Count frames that just went back on the free list
+static void framesReleased(long count) {
+	free_frames += count;
+	if (free_frames >= FRAMES_LOW_WATERMARK) memory_pressure = 0;
+}
+
+
+
+
 /*
   Add a page frame to the front of the doubly linked list
 */
@@ -221,7 +279,118 @@ void freePageFrame(void *frame) {
 		((LinkedListNode *) frame_window(1))->prev = (LinkedListNode *) frame;
 	}
 
-	TracePrintf(2, "Freed a page frame at %lX\n", (long)frame);
+	traceEvent(TRACE_FRAME_FREE, frame, 0);
+	countStat(frames_freed);
+	framesReleased(1);
+}
+
+
+
+
+/*
+  Free a whole batch of page frames at once. Rather than pushing each frame onto
+  the free list by itself, we link the unused frames to each other first, so each
+  one only gets mapped into a frame window once, and then put the whole chain at
+  the front of the list.
+
+  Note: $frames gets overwritten with the frames that were actually released.
+*/
+
+void freePageFrames(void *frames[], long count) {
+	long options = PTE_VALID | PTE_PERM_READ | PTE_PERM_WRITE;
+	long released = 0;
+
+	// Drop a reference to each frame, and hang on to the ones nobody is using anymore
+	for (long i=0; i<count; i++) {
+		frc_table[ indexOfPage(frames[i]) ] -= 1;
+		if (frc_table[ indexOfPage(frames[i]) ] == 0) frames[released++] = frames[i];
+	}
+
+	if (released == 0) return;
+
+	// Link the released frames to each other, ahead of the current free list
+	LinkedListNode *next_page = frame_head.next;
+	for (long i=0; i<released; i++) {
+		frame_window_pte(0) = createPTEWithOptions(options, indexOfPage(frames[i]));
+		((LinkedListNode *) frame_window(0))->prev = (i == 0 ? &frame_head : (LinkedListNode *) frames[i-1]);
+		((LinkedListNode *) frame_window(0))->next = (i == released-1 ? next_page : (LinkedListNode *) frames[i+1]);
+	}
+
+	// If the list was empty before, the last frame in the batch is now the tail
+	if (next_page == &frame_head) {
+		frame_head.prev = (LinkedListNode *) frames[released-1];
+	}
+
+	// Otherwise, point the old first frame back at the end of the batch
+	else {
+		frame_window_pte(1) = createPTEWithOptions(options, indexOfPage(next_page));
+		((LinkedListNode *) frame_window(1))->prev = (LinkedListNode *) frames[released-1];
+	}
+
+	frame_head.next = (LinkedListNode *) frames[0];
+	addStat(frames_freed, released);
+	traceEvent(TRACE_FRAME_FREE_BATCH, released, 0);
+	framesReleased(released);
+}
+
+
+
+
+/*
+  Count the frames on the free list by walking it, rather than trusting
+  free_frames. This is slow, so it's only for checking for leaks.
+*/
+
+long countFreeFrames() {
+	long options = PTE_VALID | PTE_PERM_READ | PTE_PERM_WRITE;
+	long count = 0;
+
+	for (LinkedListNode *node = frame_head.next; node != &frame_head; count++) {
+		frame_window_pte(0) = createPTEWithOptions(options, indexOfPage(node));
+		node = ((LinkedListNode *) frame_window(0))->next;
+	}
+
+	return count;
+}
+
+
+
+
+
+/* =============================== *
+
+  	     Memory Accounting
+
+ * =============================== */
+
+/*
+  Copy the memory usage of process $pid (or the current process, if it's 0) out to
+  $buffer, which needs room for a MemoryUsage. The shared count depends on other
+  processes' mappings, so we can't keep it up to date as we go; instead we work it
+  out here from the frame reference counts.
+*/
+
+int copyMemoryUsage(int pid, void *buffer) {
+	ProcessDescriptor *process = pid ? getProcessWithPID(pid) : getCurrentProcess();
+	errorIfNull(process, "There's no process with that PID\n");
+	if (process->state == PROCESS_ZOMBIE || process->state == PROCESS_DEAD) return ERROR;
+
+	checkForError(prepareUserRange(getCurrentProcess(), buffer, sizeof(MemoryUsage), 1));
+
+	MemoryUsage usage = process->memory;
+	usage.shared = 0;
+
+	for (int r=0; r<NUMBER_OF_MAPPED_RANGES; r++) {
+		MappedRange *range = &process->mapped_ranges[r];
+
+		for (long i=range->start; i<range->end; i++) {
+			PTE entry = process->page_table->entries[i];
+			if (entry.valid && frc_table[entry.pfn] > 1) usage.shared++;
+		}
+	}
+
+	memcpy(buffer, &usage, sizeof(MemoryUsage));
+	return SUCCESS;
 }
 
 
@@ -249,6 +418,13 @@ static int increaseKernelBrk(void *address) {
 		void *frame = allocatePageFrame();
 		if (frame == NULL) {
 			TracePrintf(1, "There aren't any page frames left for the heap :(\n");
+
+			// Give back the pages we mapped before we ran out
+			while (--i >= 0) {
+				long index = indexOfPage(KERNEL_BRK) + i;
+				freePageFrame(pageAtIndex(kernel_page_table.entries[index].pfn));
+				kernel_page_table.entries[index] = createPTEWithOptions(0, 0);
+			}
 			return -1;
 		}
 
@@ -328,6 +504,6 @@ int SetKernelBrk(void *address) {
 	}
 
 
-	TracePrintf(2, "Changed KERNEL_BRK to %lX\n", (long)KERNEL_BRK);
+	traceEvent(TRACE_KERNEL_BRK, KERNEL_BRK, 0);
 	return 0;
 }
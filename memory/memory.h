@@ -21,6 +21,9 @@
 
 #include "../include/hardware.h"
 #include "../core/list.h"
+#include "../core/stats.h"
+#include "../core/trace.h"
+#include "../core/fault.h"
 
 
 
@@ -32,6 +35,43 @@
 
  * =============================== */
 
+/*
+  Free frame watermarks. Below FRAMES_LOW_WATERMARK the machine is under memory
+  pressure, and anyone waiting on CUSTOM_MEMORY_PRESSURE gets woken up on the next
+  clock tick. The last FRAMES_MIN_WATERMARK frames are kept for the kernel: Brk
+  fails instead of dipping into them, and a page fault that needs one has to get
+  the out-of-memory killer to free some up first (see oom.c).
+*/
+
+#ifndef FRAMES_LOW_WATERMARK
+#define FRAMES_LOW_WATERMARK 64
+#endif
+
+#ifndef FRAMES_MIN_WATERMARK
+#define FRAMES_MIN_WATERMARK 16
+#endif
+
+/*
+  The memory checker (see check.c) can be run with CUSTOM_MEMORY_CHECK at any
+  time. Setting MEMORY_CHECK_INTERVAL also runs it every so many clock ticks,
+  halting the machine if anything is broken. It walks all of physical memory, so
+  that's only for debugging: it's compiled out unless MEMORY_CHECK is set to 1,
+  which the simulator build used by "make test" does.
+*/
+
+#ifndef MEMORY_CHECK
+#define MEMORY_CHECK 0
+#endif
+
+#ifndef MEMORY_CHECK_INTERVAL
+#define MEMORY_CHECK_INTERVAL 0
+#endif
+
+// How many broken invariants to log per check
+#ifndef MEMORY_CHECK_REPORT_LIMIT
+#define MEMORY_CHECK_REPORT_LIMIT 16
+#endif
+
 #define PTE_VALID 		    0x01
 #define PTE_ACCESS		    0x10
 #define PTE_MODIFIED        0x20
@@ -46,6 +86,8 @@
 
 struct PageTable;
 struct PTE;
+struct MappedRange;
+struct ProcessDescriptor;
 
 extern int VIRTUAL_MEMORY_ENABLED;
 extern void *KERNEL_DATA;
@@ -55,9 +97,13 @@ extern long PMEM_SIZE;
 extern LinkedListNode frame_head;
 extern struct PageTable kernel_page_table;
 extern char *frc_table;
+extern long free_frames;
+extern int memory_pressure;
+extern unsigned long pressure_episodes;
 
 typedef struct PTE PTE;
 typedef struct PageTable PageTable;
+typedef struct MappedRange MappedRange;
 
 
 struct PTE {
@@ -73,6 +119,27 @@ struct PageTable {
 
 
 
+/*
+  A MappedRange keeps track of a range of REGION_1 page table indices [start, end)
+  that might contain valid entries. Each process keeps one range for each of its
+  segments, so we don't have to scan the whole page table when we tear it down.
+*/
+
+enum MappedRangeType {
+	RANGE_TEXT,
+	RANGE_DATA,
+	RANGE_HEAP,
+	RANGE_STACK,
+	NUMBER_OF_MAPPED_RANGES
+};
+
+struct MappedRange {
+	long start;
+	long end;
+};
+
+
+
 
 
 /* =============================== *
@@ -106,8 +173,18 @@ struct PageTable {
 // Get the frame window PTE at a particular index
 #define get_frame_window_pte(i) (&(kernel_page_table.entries[frame_window_pte_base + (long)(i)]))
 
+// Flush the TLB, either for a single address or with TLB_FLUSH_ALL/0/1, and count it
+#define flushTLB(what) \
+    do { \
+        countTLBFlush(what); \
+        WriteRegister(REG_TLB_FLUSH, (long)(what)); \
+    } while (0)
+
+// Whether $count more frames can go to user pages without eating into the kernel's reserve
+#define userFramesAvailable(count) (free_frames - (long)(count) >= FRAMES_MIN_WATERMARK)
+
 #define frame_window_pte(i) \
-    if (VIRTUAL_MEMORY_ENABLED) { WriteRegister(REG_TLB_FLUSH, (long)frame_window(i)); } \
+    if (VIRTUAL_MEMORY_ENABLED) { flushTLB(frame_window(i)); } \
 	kernel_page_table.entries[frame_window_pte_base + (long)(i)]
 
 // Get the address of the frame window with a particular index
@@ -139,9 +216,26 @@ int setProcessBrk(void *address);
 PTE createPTEWithOptions(long options, long frame_number);
 void clearPageTable(PageTable *table);
 void handleMemoryTrap(void *address);
+int breakCopyOnWrite(struct ProcessDescriptor *process, long index);
 
 void* allocatePageFrame();
 void freePageFrame(void *frame);
+void freePageFrames(void *frames[], long count);
+long countFreeFrames();
+
+int copyMemoryUsage(int pid, void *buffer);
+
+int reclaimUserFrames(long count);
+void killForMemory(struct ProcessDescriptor *process);
+void checkMemoryPressure();
+int waitForMemoryPressure();
+
+#if MEMORY_CHECK
+int checkMemoryInvariants();
+void checkMemoryPeriodically();
+#else
+#define checkMemoryPeriodically() do { } while (0)
+#endif
 
 int SetKernelBrk(void *address);
 
@@ -0,0 +1,137 @@
+/*
+  File: oom.c
+  Date: 10/19/2026
+  Author: Mitchell Goff
+*/
+
+
+
+/* =============================== *
+
+  	         Includes
+
+ * =============================== */
+
+#include "../core/list.h"
+#include "../process/process.h"
+#include "../sync/sync.h"
+#include "memory.h"
+
+
+
+
+/* =============================== *
+
+  	           Data
+
+ * =============================== */
+
+// Processes waiting to hear that we're running low on frames
+static newWaitQueue(pressure_queue);
+
+// The pressure episode we last woke the waiters up for
+static unsigned long signalled_pressure_episode = 0;
+
+
+
+
+
+/* =============================== *
+
+  	    Out-Of-Memory Killer
+
+ * =============================== */
+
+/*
+  Pick the process to kill when we run out of frames: whichever one has the most
+  resident pages. Init is off limits, since it's what runs when nothing else can, and so
+  are threads, which get killed along with their leader. If we're a thread, our
+  own leader is off limits too, since killing it would kill us part way through.
+*/
+
+static ProcessDescriptor* chooseVictim() {
+	ProcessDescriptor *process, *victim = 0;
+
+	forEachElement(process, &process_head, process_list) {
+		if (process == getIdleProcess() || process->thread_leader) continue;
+		if (process == getCurrentProcess()->thread_leader) continue;
+		if (process->state == PROCESS_ZOMBIE || process->state == PROCESS_DEAD) continue;
+
+		if (!victim || process->memory.resident > victim->memory.resident) victim = process;
+	}
+
+	return victim;
+}
+
+
+
+
+/*
+  Kill $process to get its frames back. If it's the current process, this doesn't
+  return.
+*/
+
+void killForMemory(ProcessDescriptor *process) {
+	TracePrintf(0, "Out of memory: killing process %d (%u resident pages)\n", process->pid,
+		process->memory.resident);
+
+	countStat(oom_kills);
+	traceEvent(TRACE_OOM_KILL, process->pid, process->memory.resident);
+	killProcess(process, EXIT_OUT_OF_MEMORY);
+}
+
+
+
+
+/*
+  Make sure $count frames can go to a user page without dipping below the minimum
+  watermark, killing processes until they can. Returns ERROR if there's nobody
+  left to kill. This might kill the current process, in which case it doesn't
+  return.
+*/
+
+int reclaimUserFrames(long count) {
+	while (count > 0 && !userFramesAvailable(count)) {
+		ProcessDescriptor *victim = chooseVictim();
+		if (!victim) return ERROR;
+
+		killForMemory(victim);
+	}
+
+	return SUCCESS;
+}
+
+
+
+
+
+/* =============================== *
+
+  	      Memory Pressure
+
+ * =============================== */
+
+/*
+  Called on every clock tick. If the frame allocator has dropped below the low
+  watermark since we last checked, wake up everyone who's waiting to hear about it.
+*/
+
+void checkMemoryPressure() {
+	if (pressure_episodes == signalled_pressure_episode) return;
+
+	signalled_pressure_episode = pressure_episodes;
+	signalWaitQueueWithOptions(&pressure_queue, 0);
+}
+
+
+
+
+/*
+  Block until the machine is under memory pressure, then return the number of
+  free frames.
+*/
+
+int waitForMemoryPressure() {
+	if (!memory_pressure) sleepOnWaitQueueWithOptions(&pressure_queue, 0);
+	return free_frames;
+}
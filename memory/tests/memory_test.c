@@ -1,84 +1,203 @@
+/* Tests for memory.h */
+
 #include <stdio.h>
 #include <stdlib.h>
 #include <assert.h>
+#include <string.h>
 
 #include "../memory.h"
+#include "../../process/process.h"
+#include "../../sim/sim.h"
+
+#define PMEM_SIZE_FRAMES (SIM_PMEM_SIZE / PAGESIZE)
 
 
 void testFrameList() {
-	void *virtual_memory = malloc(VMEM_REGION_SIZE + PAGESIZE);
-	void *physical_memory = malloc(VMEM_REGION_SIZE + PAGESIZE);
-	if (!virtual_memory || !physical_memory) return;
+	unsigned long allocated = kernel_stats.frames_allocated;
+	unsigned long freed = kernel_stats.frames_freed;
 
-	// Create an artificial memory space to do testing in
-	VMEM_BASE = UP_TO_PAGE(virtual_memory);
-	VMEM_0_LIMIT = VMEM_BASE + VMEM_REGION_SIZE;
-	PMEM_BASE = UP_TO_PAGE(physical_memory);
-	KERNEL_BRK = 0;
+	// Allocate some page frames
+	void *frame1 = allocatePageFrame();
+	void *frame2 = allocatePageFrame();
+	printf("Allocated page frames %lX and %lX\n", (long)frame1, (long)frame2);
 
-	SetKernelBrk((void *)0x4000);
+	assert(frame1 && frame2 && frame1 != frame2);
+	assert(frc_table[indexOfPage(frame1)] == 1);
+	assert(frc_table[indexOfPage(frame2)] == 1);
+	assert(kernel_stats.frames_allocated == allocated + 2);
 
-	printf("Virtual Memory Start: %lX\n", VMEM_BASE);
-	printf("Virtual Memory End: %lX\n", VMEM_LIMIT);
-	printf("\n");
 
-	printf("Physical Memory Start: %lX\n", PMEM_BASE);
-	printf("Physical Memory End: %lX\n", PMEM_BASE + VMEM_REGION_SIZE);
-	printf("\n");
+	// Make sure the frame windows actually reach the page frames
+	long options = PTE_VALID | PTE_PERM_READ | PTE_PERM_WRITE;
+	frame_window_pte(0) = createPTEWithOptions(options, indexOfPage(frame1));
+	frame_window_pte(1) = createPTEWithOptions(options, indexOfPage(frame2));
+	memset(frame_window(0), 0x11, PAGESIZE);
+	memset(frame_window(1), 0x22, PAGESIZE);
 
+	frame_window_pte(2) = createPTEWithOptions(options, indexOfPage(frame1));
+	assert(((char *) frame_window(2))[PAGESIZE-1] == 0x11);
 
-	// Initialize the memory
-	createFrameList();
-	initKernelPageTable((void *)0);
 
-	printf("PTE 0: %lX\n", (long)kernel_page_table.entries[0]);
-	printf("PTE 1: %lX\n", (long)kernel_page_table.entries[1]);
-	printf("\n");
+	// Free the page frames, then make sure they come back in LIFO order
+	freePageFrame(frame1);
+	freePageFrame(frame2);
+	assert(frc_table[indexOfPage(frame1)] == 0);
 
+	assert(allocatePageFrame() == frame2);
+	assert(allocatePageFrame() == frame1);
+	freePageFrame(frame1);
+	freePageFrame(frame2);
+	assert(kernel_stats.frames_freed == freed + 4);
+}
 
-	// Allocate some page tables
-	void *frame1 = allocatePageFrame();
-	printf("Allocated page frame %lX\n", (long)frame1);
 
-	void *frame2 = allocatePageFrame();
-	printf("Allocated page frame %lX\n", (long)frame2);
-	printf("\n");
-	
 
-	// Free the page tables
-	freePageFrame(frame1);
-	printf("Freed page frame %lX\n", (long)frame1);
-	
-	freePageFrame(frame2);
-	printf("Freed page frame %lX\n", (long)frame2);
-	printf("\n");
+void testWatermarks() {
+	static void *frames[PMEM_SIZE_FRAMES];
+	long free_before = free_frames, count = 0;
+	unsigned long events = kernel_stats.pressure_events, episodes = pressure_episodes;
+
+	// Eat frames until we're under pressure, then into the kernel's reserve
+	while (free_frames >= FRAMES_MIN_WATERMARK) {
+		frames[count++] = allocatePageFrame();
+		assert(frames[count-1]);
+	}
+
+	printf("Allocated %ld frames to get below the minimum watermark\n", count);
+	assert(free_frames == free_before - count);
+	assert(memory_pressure && kernel_stats.pressure_events == events + 1);
+	assert(pressure_episodes == episodes + 1);
+	assert(!userFramesAvailable(1));
+
+	// Giving them back should end the pressure
+	freePageFrames(frames, count);
+	assert(free_frames == free_before);
+	assert(!memory_pressure && userFramesAvailable(1));
+}
+
+
+
+void testCopyOnWrite() {
+	PageTable *table = getCurrentProcess()->page_table;
+	unsigned int cow_pending = getCurrentProcess()->memory.cow_pending;
+	long index = getCurrentProcess()->mapped_ranges[RANGE_HEAP].end;
+	void *address = (void *) (VMEM_1_BASE + (long)pageAtIndex(index));
+	long options = PTE_VALID | PTE_PERM_READ | PTE_PERM_WRITE;
+
+	// Map a fresh page into the heap and write something there
+	void *frame = allocatePageFrame();
+	table->entries[index] = createPTEWithOptions(options, indexOfPage(frame));
+	WriteRegister(REG_TLB_FLUSH, (long)address);
+	strcpy(address, "Shared page");
 
+	// Pretend another process is sharing it, then break the copy-on-write
+	table->entries[index] = createPTEWithOptions(PTE_VALID | PTE_PERM_READ | PTE_COPY_ON_WRITE, indexOfPage(frame));
+	frc_table[indexOfPage(frame)] = 2;
+	getCurrentProcess()->memory.cow_pending++;
 
-	// Increase the kernel brk
-	VIRTUAL_MEMORY_ENABLED = 1;
-	SetKernelBrk((void *)0x8000);
+	assert(breakCopyOnWrite(getCurrentProcess(), index) == SUCCESS);
+	WriteRegister(REG_TLB_FLUSH, (long)address);
 
-	printf("PTE 2: %lX\n", (long)kernel_page_table.entries[2]);
-	printf("PTE 3: %lX\n", (long)kernel_page_table.entries[3]);
-	printf("\n");
+	PTE entry = table->entries[index];
+	printf("Copied %lX to %lX\n", (long)frame, (long)pageAtIndex(entry.pfn));
 
+	assert(entry.pfn != indexOfPage(frame));
+	assert(entry.perm & (PTE_PERM_WRITE >> 1));
+	assert(frc_table[indexOfPage(frame)] == 1);
+	assert(kernel_stats.cow_copies == 1);
+	assert(getCurrentProcess()->memory.cow_pending == cow_pending);
+	assert(strcmp(address, "Shared page") == 0);
+
+	// Clean up
+	freePageFrame(frame);
+	freePageFrame(pageAtIndex(entry.pfn));
+	table->entries[index] = createPTEWithOptions(0, 0);
+	WriteRegister(REG_TLB_FLUSH, (long)address);
+}
+
+
+
+void testMemoryUsage() {
+	ProcessDescriptor *process = getCurrentProcess();
+	unsigned int resident = 0, stack = 0;
+
+	// The counters should match what's actually in the page table
+	for (int r=0; r<NUMBER_OF_MAPPED_RANGES; r++) {
+		for (long i=process->mapped_ranges[r].start; i<process->mapped_ranges[r].end; i++) {
+			if (!process->page_table->entries[i].valid) continue;
+			resident++;
+			if (r == RANGE_STACK) stack++;
+		}
+	}
+
+	printf("Process %d has %u resident pages, %u in the stack\n", process->pid, resident, stack);
+	assert(process->memory.resident == resident);
+	assert(process->memory.stack == stack);
+	assert(process->memory.heap == 0);
+}
+
+
+
+void testKernelBrk() {
+	void *original_brk = KERNEL_BRK;
+
+	// Increase the kernel brk, and make sure the new pages are usable
+	assert(SetKernelBrk(original_brk + 2*PAGESIZE) == 0);
+	assert(kernel_page_table.entries[indexOfPage(original_brk)].valid);
+	assert(kernel_page_table.entries[indexOfPage(original_brk) + 1].valid);
+
+	memset(original_brk, 0x33, 2*PAGESIZE);
+	assert(((char *) original_brk)[2*PAGESIZE-1] == 0x33);
 
 	// Decrease the kernel brk
-	SetKernelBrk((void *)0x5000);
+	assert(SetKernelBrk(original_brk) == 0);
+	assert(!kernel_page_table.entries[indexOfPage(original_brk)].valid);
+	assert(KERNEL_BRK == original_brk);
+
+	// Make sure we can't grow into the kernel stack
+	assert(SetKernelBrk((void *) KERNEL_STACK_BASE) == -1);
+}
+
 
-	printf("PTE 2: %lX\n", (long)kernel_page_table.entries[2]);
-	printf("PTE 3: %lX\n", (long)kernel_page_table.entries[3]);
-	printf("\n");
+void testMemoryCheck() {
+	ProcessDescriptor *process = getCurrentProcess();
 
+	// A freshly booted machine should be consistent
+	assert(checkMemoryInvariants() == 0);
 
-	free(virtual_memory);
-	free(physical_memory);
+	// A reference count that's off by one
+	void *frame = allocatePageFrame();
+	printf("Checking with an unused frame %lX\n", (long)frame);
+	assert(checkMemoryInvariants() == 1);
+	freePageFrame(frame);
+
+	// A page that's writable and copy-on-write at the same time
+	long index = process->mapped_ranges[RANGE_STACK].end - 1;
+	PTE entry = process->page_table->entries[index];
+	long options = PTE_VALID | (entry.perm << 1) | (entry.misc << 4);
+	process->page_table->entries[index] = createPTEWithOptions(options | PTE_COPY_ON_WRITE, entry.pfn);
+	process->memory.cow_pending++;
+	assert(checkMemoryInvariants() == 1);
+
+	process->page_table->entries[index] = entry;
+	process->memory.cow_pending--;
+
+	// A frame that's back on the free list while it's still mapped
+	freePageFrame(pageAtIndex(entry.pfn));
+	assert(checkMemoryInvariants() == 1);
 }
 
 
 int main() {
+	simBoot(NULL);
+
 	testFrameList();
+	testWatermarks();
+	testCopyOnWrite();
+	testMemoryUsage();
+	testKernelBrk();
+	testMemoryCheck();
 
 	printf("All tests passed!\n");
 	return 0;
-}
\ No newline at end of file
+}
@@ -34,7 +34,19 @@ int createPageTable(ProcessDescriptor *child, ProcessDescriptor *parent) {
     PageTable *table = (PageTable *) malloc(sizeof(PageTable));
     errorIfNull(table, "There's not enough space for a new page table!\n");
     memcpy(table, parent->page_table, sizeof(PageTable));
+    memcpy(child->mapped_ranges, parent->mapped_ranges, sizeof(child->mapped_ranges));
+    child->memory = parent->memory;
     child->page_table = table;
+    return SUCCESS;
+}
+
+
+// Give back the frames we copied into the child's entries [start, end), if we couldn't copy the rest
+static void freeCopiedPages(ProcessDescriptor *child, ProcessDescriptor *parent, int start, int end) {
+    for (int i=start; i<end; i++) {
+        PTE entry = child->page_table->entries[i];
+        if (entry.valid && entry.pfn != parent->page_table->entries[i].pfn) freePageFrame(pageAtIndex(entry.pfn));
+    }
 }
 
 
@@ -47,11 +59,19 @@ int copyParentStack(ProcessDescriptor *child, ProcessDescriptor *parent) {
 
         long options = PTE_VALID | (old_entry.perm << 1) | (old_entry.misc << 4);
         void *frame = allocatePageFrame();
+        if (!frame) {
+            TracePrintf(1, "There aren't enough page frames to copy the stack!\n");
+            freeCopiedPages(child, parent, stack_base, i);
+            return ERROR;
+        }
+
         child->page_table->entries[i] = createPTEWithOptions(options, indexOfPage(frame));
 
         frame_window_pte(0) = createPTEWithOptions(PTE_VALID | PTE_PERM_READ | PTE_PERM_WRITE, indexOfPage(frame));
         memcpy(frame_window(0), (void *)(VMEM_1_BASE + (long) pageAtIndex(i)), PAGESIZE);
     }
+
+    return SUCCESS;
 }
 
 
@@ -65,11 +85,19 @@ int copyParentData(ProcessDescriptor *child, ProcessDescriptor *parent) {
         if (!old_entry.valid || !(options & PTE_PERM_WRITE)) continue;
         
         void *frame = allocatePageFrame();
+        if (!frame) {
+            TracePrintf(1, "There aren't enough page frames to copy the data!\n");
+            freeCopiedPages(child, parent, 0, i);
+            return ERROR;
+        }
+
         child->page_table->entries[i] = createPTEWithOptions(options, indexOfPage(frame));
 
         frame_window_pte(0) = createPTEWithOptions(PTE_VALID | PTE_PERM_READ | PTE_PERM_WRITE, indexOfPage(frame));
         memcpy(frame_window(0), (void *)(VMEM_1_BASE + (long) pageAtIndex(i)), PAGESIZE);
     }
+
+    return SUCCESS;
 }
 
 
@@ -81,6 +109,8 @@ int increaseFRCEntries(ProcessDescriptor *child, ProcessDescriptor *parent) {
         if (!old_entry.valid) continue;
         frc_table[old_entry.pfn]++;
     }
+
+    return SUCCESS;
 }
 
 
@@ -98,6 +128,21 @@ int createUserContext(ProcessDescriptor *child, ProcessDescriptor *parent) {
     child_info->data_start = parent_info->data_start;
     child_info->heap_start = parent_info->heap_start;
     child_info->current_brk = parent_info->current_brk;
+    return SUCCESS;
+}
+
+
+
+
+/*
+  Throw away a child we couldn't finish setting up. It hasn't been linked into
+  any lists yet, so all we have to give back is what it owns.
+*/
+
+static void abandonChild(ProcessDescriptor *child) {
+    free(child->page_table);
+    freeKernelStack(child->pcb_frames);
+    releaseProcess(child);
 }
 
 
@@ -117,23 +162,31 @@ int forkProcess() {
         return ERROR;
     }
 
+    // Make sure we have a link for our children to point at
+    ParentLink *link = getChildLink(parent);
+    errorIfNull(link, "There's not enough space for a new parent link!\n");
+
     // Try to allocate space for the new process descriptor
     ProcessDescriptor *child = createProcessDescriptor();
     errorIfNull(child, "There's not enough space for a new process descriptor!\n");
 
 
-    // Call the helper functions
-    checkForError(createPageTable(child, parent));
-    checkForError(copyParentStack(child, parent));
-    checkForError(createUserContext(child, parent));
+    // Call the helper functions, and give up on the child if any of them fail
+    if (createPageTable(child, parent) == ERROR ||
+        copyParentStack(child, parent) == ERROR ||
+        createUserContext(child, parent) == ERROR) {
+        abandonChild(child);
+        return ERROR;
+    }
 
     // Set the copy-on-write bits
-    setCopyOnWrite(parent->page_table, 0);
-    setCopyOnWrite(child->page_table, 1);
+    setCopyOnWrite(parent, 0);
+    setCopyOnWrite(child, 1);
 
 
     // Set up the linked lists connecting the parent to the child
-    child->parent = parent;
+    child->parent_link = link;
+    link->references++;
     addLastNode(&child->siblings, &parent->children);
     addLastNode(&child->process_list, &process_head);
 
@@ -168,10 +221,13 @@ int createThread() {
     errorIfNull(child, "There's not enough space for a new process descriptor!\n");
 
 
-    // Call the helper functions
-    checkForError(createPageTable(child, parent));
-    checkForError(copyParentStack(child, parent));
-    checkForError(createUserContext(child, parent));
+    // Call the helper functions, and give up on the thread if any of them fail
+    if (createPageTable(child, parent) == ERROR ||
+        copyParentStack(child, parent) == ERROR ||
+        createUserContext(child, parent) == ERROR) {
+        abandonChild(child);
+        return ERROR;
+    }
     increaseFRCEntries(child, parent);
 
 
@@ -17,6 +17,7 @@
 #include "../include/hardware.h"
 #include "../memory/memory.h"
 #include "../traps/traps.h"
+#include "../sync/sync.h"
 #include "process.h"
 
 
@@ -28,6 +29,41 @@
 
  * =============================== */
 
+/*
+  Hand an exiting process over to whoever is waiting for it. Its parent (or its
+  thread leader, if it's a thread) may have someone sleeping on its exit queue
+  in Wait() or JoinThread(). We wake up the first waiter that wants this process
+  and mark the process as dead, so nobody else tries to claim it. Returns 1 if
+  somebody claimed the process, or 0 otherwise.
+*/
+
+static int notifyProcessExit(ProcessDescriptor *process) {
+	ProcessDescriptor *owner = process->thread_leader ? process->thread_leader : getParentProcess(process);
+	if (!owner) return 0;
+
+	WaitQueueNode *waiter;
+	forEachElement(waiter, &owner->exit_queue.head, node) {
+		PID wanted = (PID)(long) waiter->data;
+
+		// Threads can only be joined by their PID, but Wait() will take any child
+		if (wanted == process->pid || (wanted == 1 && !process->thread_leader)) {
+			removeNode(&waiter->node);
+			removeNode(&process->siblings);
+			linkedListNodeInit(&process->siblings);
+
+			waiter->data = process;
+			process->state = PROCESS_DEAD;
+			waiter->prepareToWakeUp(waiter);
+			return 1;
+		}
+	}
+
+	return 0;
+}
+
+
+
+
 /*
   Kill the current process and switch to a new one
 */
@@ -35,51 +71,76 @@
 void killProcess(ProcessDescriptor *process, int status) {
 	if (process->state == PROCESS_ZOMBIE || process->state == PROCESS_DEAD) return;
 	TracePrintf(1, "Exiting Process %d\n", process->pid);
-	
 
-	// Figure out which process to run next
-	int should_switch_processes = (process == getCurrentProcess());
-	LinkedListNode *node = &process->process_list;
-	ProcessDescriptor *new_process;
-	while (should_switch_processes) {
-		node = node->next;
-		if (node == &process_head) continue;
-
-		new_process = elementForNode(node, ProcessDescriptor, process_list);
-		if (new_process->state != PROCESS_RUNNING) continue;
-		if (new_process->wake_up_time > elapsed_clock_ticks) continue;
-		
-		break;
-	}
+	// If we're being killed in our sleep, get off the waitqueue first
+	detachFromWaitQueue(process);
 
 
 	// Free any data structures we've allocated for this process
 	freeAddressSpace(process);
 	free(process->page_table);
 
-	// Free any children who have exited, and give the rest to our parent
-	ProcessDescriptor *current;
-	forEachElement(current, &process->children, siblings) {
-        if (current->state == PROCESS_ZOMBIE)
-            releaseProcess(current);
-    	else current->parent = process->parent;
-    }
-    spliceLinkedLists(&process->children, &process->parent->children);
+	// Hand our children and our unreaped zombies to the idle process. Since our
+	// children all find us through our child link, this doesn't touch any of them.
+	if (process->child_link) {
+		ProcessDescriptor *idle = getIdleProcess();
+		process->child_link->process = idle;
+
+		spliceLinkedLists(&process->children, &idle->children);
+		spliceLinkedLists(&process->zombies, &idle->zombies);
+		linkedListNodeInit(&process->children);
+		linkedListNodeInit(&process->zombies);
+	}
+
+	// Kill any threads we might have spawned
+	while (!listIsEmpty(&process->thread_group)) {
+		ProcessDescriptor *thread = elementForNode(process->thread_group.next, ProcessDescriptor, thread_peers);
+		killProcess(thread, -1);
+		releaseProcess(thread);
+	}
+
 
-    // Kill any threads we might have spawned
-	forEachElement(current, &process->thread_group, thread_peers) {
-        killProcess(current, -1);
-        releaseProcess(current);
-    }
+	// Pass on any locks we're holding, then clean up the locks and condition
+	// variables we created
+	releaseHeldLocks(process);
+	releaseOwnedResources(process);
+
+	// Wake up anybody who was in the middle of a message exchange with us
+	cancelMessages(process);
 
 
 	// Modify the process descriptor
-	getCurrentProcess()->state = PROCESS_ZOMBIE;
-	getCurrentProcess()->exit_status = status;
+	process->state = PROCESS_ZOMBIE;
+	process->exit_status = status;
+
+	// If nobody is waiting for us yet, move onto our parent's zombie list
+	ProcessDescriptor *parent = getParentProcess(process);
+	if (!notifyProcessExit(process) && parent && !process->thread_leader) {
+		removeNode(&process->siblings);
+		addLastNode(&process->siblings, &parent->zombies);
+	}
 
-	if (should_switch_processes) {
-		KernelContextSwitch(killKernelContext, process, new_process);
+	// If we're not running on the process's kernel stack, we can give it back right away
+	if (process != getCurrentProcess()) {
+		freeKernelStack(process->pcb_frames);
+		return;
 	}
+
+	// Otherwise, figure out which process to run next and switch to it
+	LinkedListNode *node = &process->process_list;
+	ProcessDescriptor *new_process;
+	while (1) {
+		node = node->next;
+		if (node == &process_head) continue;
+
+		new_process = elementForNode(node, ProcessDescriptor, process_list);
+		if (new_process->state != PROCESS_RUNNING) continue;
+		if (new_process->wake_up_time > elapsed_clock_ticks) continue;
+
+		break;
+	}
+
+	KernelContextSwitch(killKernelContext, process, new_process);
 }
 
 
@@ -97,27 +158,39 @@ void killCurrentProcess(int status) {
 
 
 /*
-  Release the process descriptor of a zombie process
+  Release the process descriptor of a zombie process. Its children were already
+  handed to the idle process when it exited, so there's nothing to walk here.
 */
 
 void releaseProcess(ProcessDescriptor *process) {
-	ProcessDescriptor *current;
-
-	// Go through our children and release any zombies
-	forEachElement(current, &process->children, siblings) {
-		if (current->state == PROCESS_ZOMBIE) {
-			releaseProcess(current);
-		}
-		current->parent = process->parent;
-	}
 
 	// Remove the process from any lists
-	spliceLinkedLists(&process->children, &getIdleProcess()->children);
-	removeNode(&process->children);
 	removeNode(&process->siblings);
-	
+	removeNode(&process->thread_peers);
 	removeNode(&process->process_list);
 
-	// Free the process descriptor
+	// Let go of our parent's link and our own
+	dropParentLink(process->parent_link);
+	dropParentLink(process->child_link);
+
+	// Free the process descriptor and recycle its PID
+	releasePID(process->pid);
 	free(process);
 }
+
+
+
+
+/*
+  Release a bounded number of the zombies that have been handed to the idle
+  process. This runs on every clock tick, so that a process exiting with lots
+  of unreaped children doesn't have to release them all at once.
+*/
+
+void reapOrphanedZombies() {
+	ProcessDescriptor *idle = getIdleProcess();
+
+	for (int i=0; i<ORPHAN_REAP_BATCH && !listIsEmpty(&idle->zombies); i++) {
+		releaseProcess(elementForNode(idle->zombies.next, ProcessDescriptor, siblings));
+	}
+}
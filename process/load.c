@@ -140,6 +140,16 @@ int loadProgram(char *name, char *args[]) {
     }
 
 
+    // Get a buffer in region 0 to save the arguments in, since region 1 is
+    // about to go away. This is the last thing that can fail harmlessly.
+    argbuf = (char *) malloc(size);
+    if (!argbuf) {
+        TracePrintf(1, "There's no more space in the heap\n");
+        close(fd);
+        return ERROR;
+    }
+
+
 
     
 
@@ -153,10 +163,8 @@ int loadProgram(char *name, char *args[]) {
     process->user_context.sp = cp2;
 
     
-    // Now save the arguments in a separate buffer in region 0, since
-    // region 1 doesn't exist yet for this process
-    cp2 = argbuf = (char *) malloc(size);
-    errorIfNull(argbuf, "There's no more space in the heap\n");
+    // Now save the arguments in the buffer we got earlier
+    cp2 = argbuf;
 
     for (i=0; args[i] != NULL; i++) {
         TracePrintf(3, "saving arg %d = '%s'\n", i, args[i]);
@@ -177,22 +185,29 @@ int loadProgram(char *name, char *args[]) {
     ((ProcessInfo *) KERNEL_STACK_BASE)->heap_start =  pageAtIndex(data_pg1 + data_npg) + VMEM_1_BASE;
     ((ProcessInfo *) KERNEL_STACK_BASE)->current_brk = pageAtIndex(data_pg1 + data_npg) + VMEM_1_BASE;
 
+    // Keep track of where each segment lives in the page table
+    process->mapped_ranges[RANGE_TEXT] = (MappedRange) { text_pg1, text_pg1 + li.t_npg };
+    process->mapped_ranges[RANGE_DATA] = (MappedRange) { data_pg1, data_pg1 + data_npg };
+    process->mapped_ranges[RANGE_HEAP] = (MappedRange) { data_pg1 + data_npg, data_pg1 + data_npg };
+    process->mapped_ranges[RANGE_STACK] = (MappedRange) { stack_pg1, MAX_PT_LEN };
+    process->memory = (MemoryUsage) { li.t_npg + data_npg + stack_npg, 0, 0, 0, stack_npg };
+
 
 
     // Now allocate some physical pages and map them to the right places
     // in text, data and stack segments, marking everything as writable
     for (i=0; i<li.t_npg; i++) {
-        void *frame = allocatePageFrame(); killIfNull(frame, "We're out of page frames\n");
+        void *frame = allocatePageFrame(); if (!frame) goto out_of_frames;
         PTE entry = createPTEWithOptions(data_options, indexOfPage(frame));
         process->page_table->entries[text_pg1 + i] = entry;
     }
     for (i=0; i<data_npg; i++) {
-        void *frame = allocatePageFrame(); killIfNull(frame, "We're out of page frames\n");
+        void *frame = allocatePageFrame(); if (!frame) goto out_of_frames;
         PTE entry = createPTEWithOptions(data_options, indexOfPage(frame));
         process->page_table->entries[data_pg1 + i] = entry;
     }
     for (i=0; i<stack_npg; i++) {
-        void *frame = allocatePageFrame(); killIfNull(frame, "We're out of page frames\n");
+        void *frame = allocatePageFrame(); if (!frame) goto out_of_frames;
         PTE entry = createPTEWithOptions(data_options, indexOfPage(frame));
         process->page_table->entries[stack_pg1 + i] = entry;
     }
@@ -202,7 +217,7 @@ int loadProgram(char *name, char *args[]) {
     }
 
     // Flush the TLB for region 1 so we can write to these pages
-    WriteRegister(REG_TLB_FLUSH, TLB_FLUSH_1);
+    flushTLB(TLB_FLUSH_1);
 
 
 
@@ -211,19 +226,13 @@ int loadProgram(char *name, char *args[]) {
     lseek(fd, li.t_faddr, SEEK_SET);
     segment_size = li.t_npg << PAGESHIFT;
 
-    if (read(fd, (void *) li.t_vaddr, segment_size) != segment_size) {
-        close(fd);
-        return KILL;
-    }
+    if (read(fd, (void *) li.t_vaddr, segment_size) != segment_size) goto failed;
 
     // Read the text from the file into memory.
     lseek(fd, li.id_faddr, 0);
     segment_size = li.id_npg << PAGESHIFT;
 
-    if (read(fd, (void *) li.id_vaddr, segment_size) != segment_size) {
-        close(fd);
-        return KILL;
-    }
+    if (read(fd, (void *) li.id_vaddr, segment_size) != segment_size) goto failed;
 
     // Now set the page table entries for the program text to be readable
     // and executable, but not writable.
@@ -234,7 +243,7 @@ int loadProgram(char *name, char *args[]) {
     }
 
     // Flush the TLB for region 1 now that we've updated the PTEs for the text
-    WriteRegister(REG_TLB_FLUSH, TLB_FLUSH_1);
+    flushTLB(TLB_FLUSH_1);
 
     // Zero out the uninitialized data area
     memset((void *) li.id_end, 0x00, li.ud_end - li.id_end);
@@ -269,4 +278,15 @@ int loadProgram(char *name, char *args[]) {
     *cpp++ = NULL;			/* a NULL pointer for an empty envp */
 
     return SUCCESS;
+
+
+    // Past the point of no return, all we can do is clean up and have the caller
+    // kill the process. Whatever frames we did get are in its mapped ranges.
+    out_of_frames:
+    TracePrintf(1, "We're out of page frames\n");
+
+    failed:
+    close(fd);
+    free(argbuf);
+    return KILL;
 }
@@ -0,0 +1,371 @@
+/*
+  File: message.c
+  Date: 10/19/2026
+  Author: Mitchell Goff
+*/
+
+
+/* =============================== *
+
+             Includes
+
+ * =============================== */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "../include/hardware.h"
+#include "../include/yalnix.h"
+#include "../memory/memory.h"
+#include "process.h"
+
+
+
+
+/* =============================== *
+
+               Data
+
+ * =============================== */
+
+/*
+  Message passing is synchronous: Send blocks until the receiver calls Reply.
+  A message never gets buffered in the kernel. While a sender is blocked its
+  buffer can't change, so the receiver copies the message straight out of the
+  sender's address space, and the reply goes straight back into it. Both
+  copies map the other process's pages through the frame windows.
+
+  When a Send finds its receiver already waiting in Receive, or a Reply wakes
+  up the sender, we switch straight to the woken process instead of going
+  through the scheduler, so a round trip only takes two context switches.
+*/
+
+static PID services[MAX_SERVICES];
+
+#define min(a, b) ((a) < (b) ? (a) : (b))
+#define pageIndex(address) indexOfPage(DOWN_TO_PAGE(address) - VMEM_1_BASE)
+
+
+
+
+/* =============================== *
+
+           Implementation
+
+ * =============================== */
+
+/*
+  Check that $length bytes at $address are mapped in $process's address space.
+  If we're going to write to them, we break copy-on-write up front, so the copy
+  itself never has to allocate anything.
+*/
+
+int prepareUserRange(ProcessDescriptor *process, void *address, long length, int writing) {
+	long start = (long) address;
+	if (length < 0 || start < VMEM_1_BASE || start + length > VMEM_1_LIMIT || start + length < start) return ERROR;
+	if (length == 0) return SUCCESS;
+
+	long permission = writing ? PTE_PERM_WRITE : PTE_PERM_READ;
+	for (long index = pageIndex(start); index <= pageIndex(start + length - 1); index++) {
+		PTE entry = process->page_table->entries[index];
+		long options = (entry.perm << 1) | (entry.misc << 4);
+		if (!entry.valid) return ERROR;
+
+		if (writing && (options & PTE_COPY_ON_WRITE)) {
+			checkForError(breakCopyOnWrite(process, index));
+			if (process == getCurrentProcess()) flushTLB(VMEM_1_BASE + (long) pageAtIndex(index));
+		}
+		else if (!(options & permission)) return ERROR;
+	}
+
+	return SUCCESS;
+}
+
+
+
+// Map the page containing $address in $process's address space into a frame window
+static char* mapUserAddress(ProcessDescriptor *process, long address, int window) {
+	PTE entry = process->page_table->entries[pageIndex(address)];
+	long options = PTE_VALID | PTE_PERM_READ | PTE_PERM_WRITE;
+	frame_window_pte(window) = createPTEWithOptions(options, entry.pfn);
+	return (char *) frame_window(window) + (address & PAGEOFFSET);
+}
+
+
+
+// Copy between two (already prepared) user address spaces, one page span at a time
+static void copyBetweenProcesses(ProcessDescriptor *to, void *to_address, ProcessDescriptor *from, void *from_address, long length) {
+	long destination = (long) to_address, source = (long) from_address;
+
+	while (length > 0) {
+		long count = min(length, min(PAGESIZE - (destination & PAGEOFFSET), PAGESIZE - (source & PAGEOFFSET)));
+		memcpy(mapUserAddress(to, destination, 2), mapUserAddress(from, source, 1), count);
+
+		destination += count;
+		source += count;
+		length -= count;
+	}
+}
+
+
+
+
+/*
+  Find the process a message is addressed to. Negative IDs refer to a service
+  that some server has registered.
+*/
+
+static ProcessDescriptor* findReceiver(int pid) {
+	if (pid < 0) {
+		if (-pid >= MAX_SERVICES) return 0;
+		pid = services[-pid];
+	}
+
+	ProcessDescriptor *process = pid ? getProcessWithPID(pid) : 0;
+	if (!process || process->state == PROCESS_ZOMBIE || process->state == PROCESS_DEAD) return 0;
+	return process;
+}
+
+
+
+// Look up a sender that's blocked waiting for the current process to reply
+static ProcessDescriptor* findReplyingSender(int pid) {
+	ProcessDescriptor *sender = getProcessWithPID(pid);
+	if (!sender || sender->message.state != MESSAGE_REPLYING) return 0;
+	return sender->message.partner == getCurrentProcess()->pid ? sender : 0;
+}
+
+
+
+// Wake up a blocked sender, making Send return $status
+static void releaseSender(ProcessDescriptor *sender, long status) {
+	removeNode(&sender->message.node);
+	linkedListNodeInit(&sender->message.node);
+
+	sender->message.state = MESSAGE_IDLE;
+	sender->message.partner = 0;
+	sender->message.status = status;
+	markProcessRunnable(sender);
+}
+
+
+
+
+/*
+  Hand $sender's message to $receiver. If the receiver is already waiting for it,
+  the message gets copied over right away and the receiver is woken up; returns 1
+  in that case. Otherwise the sender gets queued up until the receiver asks.
+*/
+
+static int deliverMessage(ProcessDescriptor *sender, ProcessDescriptor *receiver) {
+	MessageInfo *message = &receiver->message;
+	sender->message.partner = receiver->pid;
+
+	if (message->state == MESSAGE_RECEIVING && (!message->partner || message->partner == sender->pid)) {
+		copyBetweenProcesses(receiver, message->buffer, sender, sender->message.buffer, MESSAGE_SIZE);
+
+		sender->message.state = MESSAGE_REPLYING;
+		addLastNode(&sender->message.node, &message->replies);
+
+		message->state = MESSAGE_IDLE;
+		message->partner = sender->pid;
+		markProcessRunnable(receiver);
+		return 1;
+	}
+
+	sender->message.state = MESSAGE_SENDING;
+	addLastNode(&sender->message.node, &message->senders);
+	return 0;
+}
+
+
+
+
+/*
+  Register the current process as the server for $service_id
+*/
+
+int registerService(unsigned int service_id) {
+	if (service_id == 0 || service_id >= MAX_SERVICES) {
+		TracePrintf(1, "Service ID %u is out of range\n", service_id);
+		return ERROR;
+	}
+
+	if (findReceiver(-(int) service_id)) {
+		TracePrintf(1, "Service %u is already registered\n", service_id);
+		return ERROR;
+	}
+
+	services[service_id] = getCurrentProcess()->pid;
+	return SUCCESS;
+}
+
+
+
+
+/*
+  Send a message to $pid and block until it replies. The reply overwrites the
+  message in place.
+*/
+
+int sendMessage(void *message, int pid) {
+	ProcessDescriptor *sender = getCurrentProcess();
+	ProcessDescriptor *receiver = findReceiver(pid);
+	errorIfNull(receiver, "It looks like you're sending a message to a non-valid process\n");
+
+	if (receiver == sender || prepareUserRange(sender, message, MESSAGE_SIZE, 1) == ERROR) {
+		TracePrintf(1, "Can't send message %p to process %d\n", message, pid);
+		return ERROR;
+	}
+
+	sender->message.buffer = message;
+	sender->state = PROCESS_WAITING;
+
+	// If the receiver is already waiting for us, switch straight to it
+	if (deliverMessage(sender, receiver)) {
+		KernelContextSwitch(switchKernelContext, sender, receiver);
+	}
+	else schedule();
+
+	return sender->message.status;
+}
+
+
+
+
+/*
+  Block until a message arrives, from $pid if it's nonzero or from anyone
+  otherwise. Returns the PID of the sender.
+*/
+
+int receiveMessage(void *message, PID pid) {
+	ProcessDescriptor *receiver = getCurrentProcess();
+	ProcessDescriptor *sender;
+
+	if (prepareUserRange(receiver, message, MESSAGE_SIZE, 1) == ERROR) {
+		TracePrintf(1, "Can't receive a message into %p\n", message);
+		return ERROR;
+	}
+
+	// If someone is already waiting, take their message right away
+	forEachElement(sender, &receiver->message.senders, message.node) {
+		if (pid && sender->pid != pid) continue;
+
+		copyBetweenProcesses(receiver, message, sender, sender->message.buffer, MESSAGE_SIZE);
+
+		removeNode(&sender->message.node);
+		addLastNode(&sender->message.node, &receiver->message.replies);
+		sender->message.state = MESSAGE_REPLYING;
+		return sender->pid;
+	}
+
+	// Otherwise, wait for the sender to copy the message over and wake us up
+	receiver->message.state = MESSAGE_RECEIVING;
+	receiver->message.buffer = message;
+	receiver->message.partner = pid;
+	putProcessToSleep(0);
+
+	receiver->message.buffer = 0;
+	return receiver->message.partner;
+}
+
+
+
+
+/*
+  Copy a reply into the buffer of a sender we received from, and switch straight
+  back to it
+*/
+
+int replyToMessage(void *message, int pid) {
+	ProcessDescriptor *receiver = getCurrentProcess();
+	ProcessDescriptor *sender = findReplyingSender(pid);
+	errorIfNull(sender, "It looks like you're replying to a process that isn't waiting on you\n");
+	checkForError(prepareUserRange(receiver, message, MESSAGE_SIZE, 0));
+
+	copyBetweenProcesses(sender, sender->message.buffer, receiver, message, MESSAGE_SIZE);
+	releaseSender(sender, SUCCESS);
+
+	KernelContextSwitch(switchKernelContext, receiver, sender);
+	return SUCCESS;
+}
+
+
+
+
+/*
+  Pass a message we received from $source_pid on to $destination_pid, as if the
+  source had sent it there itself. The source stays blocked until the new
+  receiver replies.
+*/
+
+int forwardMessage(void *message, int destination_pid, int source_pid) {
+	ProcessDescriptor *sender = findReplyingSender(source_pid);
+	errorIfNull(sender, "It looks like you're forwarding a message from a process that isn't waiting on you\n");
+	checkForError(prepareUserRange(getCurrentProcess(), message, MESSAGE_SIZE, 0));
+
+	// If the destination doesn't exist, the source's Send fails
+	ProcessDescriptor *receiver = findReceiver(destination_pid);
+	if (!receiver || receiver == sender) {
+		releaseSender(sender, ERROR);
+		TracePrintf(1, "Can't forward a message to process %d\n", destination_pid);
+		return ERROR;
+	}
+
+	copyBetweenProcesses(sender, sender->message.buffer, getCurrentProcess(), message, MESSAGE_SIZE);
+	removeNode(&sender->message.node);
+	deliverMessage(sender, receiver);
+	return SUCCESS;
+}
+
+
+
+
+/*
+  Copy data into or out of the address space of a sender that's waiting for us
+  to reply
+*/
+
+int copyFromProcess(int source_pid, void *destination, void *source, int length) {
+	ProcessDescriptor *sender = findReplyingSender(source_pid);
+	errorIfNull(sender, "Can only copy from a process that's waiting on us to reply\n");
+
+	checkForError(prepareUserRange(getCurrentProcess(), destination, length, 1));
+	checkForError(prepareUserRange(sender, source, length, 0));
+
+	copyBetweenProcesses(getCurrentProcess(), destination, sender, source, length);
+	return SUCCESS;
+}
+
+int copyToProcess(int destination_pid, void *destination, void *source, int length) {
+	ProcessDescriptor *sender = findReplyingSender(destination_pid);
+	errorIfNull(sender, "Can only copy to a process that's waiting on us to reply\n");
+
+	checkForError(prepareUserRange(sender, destination, length, 1));
+	checkForError(prepareUserRange(getCurrentProcess(), source, length, 0));
+
+	copyBetweenProcesses(sender, destination, getCurrentProcess(), source, length);
+	return SUCCESS;
+}
+
+
+
+
+/*
+  Pull an exiting process out of any message exchanges it's part of. Anyone that
+  was still waiting on it gets woken up with an error.
+*/
+
+void cancelMessages(ProcessDescriptor *process) {
+	removeNode(&process->message.node);
+	linkedListNodeInit(&process->message.node);
+	process->message.state = MESSAGE_IDLE;
+
+	while (!listIsEmpty(&process->message.senders)) {
+		releaseSender(elementForNode(process->message.senders.next, ProcessDescriptor, message.node), ERROR);
+	}
+
+	while (!listIsEmpty(&process->message.replies)) {
+		releaseSender(elementForNode(process->message.replies.next, ProcessDescriptor, message.node), ERROR);
+	}
+}
@@ -0,0 +1,112 @@
+/*
+  File: pid.c
+  Date: 10/19/2026
+  Author: Mitchell Goff
+*/
+
+
+/* =============================== *
+
+             Includes
+
+ * =============================== */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "../include/hardware.h"
+#include "process.h"
+
+
+
+
+/* =============================== *
+
+               Data
+
+ * =============================== */
+
+/*
+  Every PID is made up of a slot number and a generation number:
+
+    pid = generation * MAX_PROCESSES + slot
+
+  The slot indexes straight into the process table, so looking up a process by its
+  PID is a single array access. Whenever a slot is freed its generation gets bumped,
+  so a recycled slot never hands out a PID that was in use recently, and a stale PID
+  won't match the new process living in the slot. Slot 0 is never used, so 0 is
+  never a valid PID.
+*/
+
+#define BITS_PER_WORD (8 * sizeof(unsigned long))
+#define PID_BITMAP_WORDS (MAX_PROCESSES / BITS_PER_WORD)
+#define MAX_PID_GENERATION (INT_MAX / MAX_PROCESSES)
+
+#define slotOfPID(pid) ((pid) & (MAX_PROCESSES - 1))
+
+static unsigned long pid_bitmap[PID_BITMAP_WORDS] = { 1 };
+static unsigned int pid_generations[MAX_PROCESSES];
+static ProcessDescriptor *process_table[MAX_PROCESSES];
+static unsigned int next_pid_slot = 1;
+
+
+
+
+/* =============================== *
+
+           Implementation
+
+ * =============================== */
+
+/*
+  Find a free slot in the PID bitmap, starting from wherever we left off last
+  time, and map the new PID to $process. Returns 0 if every slot is taken.
+*/
+
+PID allocatePID(ProcessDescriptor *process) {
+	for (unsigned int i=0; i<PID_BITMAP_WORDS; i++) {
+		int word = (next_pid_slot / BITS_PER_WORD + i) % PID_BITMAP_WORDS;
+		unsigned long free_bits = ~pid_bitmap[word];
+		if (!free_bits) continue;
+
+		// Claim the lowest free slot in this word
+		unsigned int slot = word * BITS_PER_WORD + __builtin_ctzl(free_bits);
+		pid_bitmap[word] |= 1UL << (slot % BITS_PER_WORD);
+		process_table[slot] = process;
+		next_pid_slot = (slot + 1) % MAX_PROCESSES;
+
+		return pid_generations[slot] * MAX_PROCESSES + slot;
+	}
+
+	TracePrintf(1, "We're out of process IDs!\n");
+	return 0;
+}
+
+
+
+
+/*
+  Give a PID back to the allocator. The slot's generation is bumped so the same
+  PID won't come around again until the generation counter wraps.
+*/
+
+void releasePID(PID pid) {
+	unsigned int slot = slotOfPID(pid);
+	if (slot == 0 || !process_table[slot] || process_table[slot]->pid != pid) return;
+
+	pid_bitmap[slot / BITS_PER_WORD] &= ~(1UL << (slot % BITS_PER_WORD));
+	process_table[slot] = 0;
+	pid_generations[slot] = (pid_generations[slot] + 1) % MAX_PID_GENERATION;
+}
+
+
+
+
+/*
+  Look up a process descriptor by its PID in constant time
+*/
+
+ProcessDescriptor* getProcessWithPID(PID pid) {
+	ProcessDescriptor *process = process_table[slotOfPID(pid)];
+	return (process && process->pid == pid) ? process : 0;
+}
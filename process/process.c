@@ -32,7 +32,6 @@
  * =============================== */
 
 LinkedListNode process_head = linkedListNode(process_head);
-long max_pid = 0;
 
 
 
@@ -44,31 +43,47 @@ long max_pid = 0;
  * =============================== */
 
 /*
-  Deallocate all of the page frames that this process is currently using.
+  Deallocate all of the page frames that this process is currently using. We only
+  scan the ranges where the process's segments live, and free all the frames we
+  find in a single batch.
 */
 
 void freeAddressSpace(ProcessDescriptor *process) {
     PageTable *page_table = process->page_table;
+    void *frames[MAX_PT_LEN];
+    long count = 0;
 
-    // Go through the page table and free any valid page frames
-    for (int i=0; i<indexOfPage(VMEM_REGION_SIZE); i++) {
-        PTE entry = page_table->entries[i];
-        if (!entry.valid) continue;
-        freePageFrame((void *) pageAtIndex(entry.pfn));
+    // Go through each mapped range, collecting the frames and clearing the entries
+    for (int r=0; r<NUMBER_OF_MAPPED_RANGES; r++) {
+        MappedRange *range = &process->mapped_ranges[r];
+
+        for (long i=range->start; i<range->end; i++) {
+            PTE entry = page_table->entries[i];
+            if (!entry.valid) continue;
+
+            frames[count++] = pageAtIndex(entry.pfn);
+            page_table->entries[i] = createPTEWithOptions(0, 0);
+        }
+
+        range->start = range->end = 0;
     }
 
-    // Clear all entries in the page table
-    clearPageTable(page_table);
+    memset(&process->memory, 0x00, sizeof(process->memory));
+
+    // Then free the frames, and flush the TLB once if this is our own address space
+    freePageFrames(frames, count);
+    if (process == getCurrentProcess()) flushTLB(TLB_FLUSH_1);
 }
 
 
 
 
 /*
-  Mark all writeable entries in a page table as copy-on-write
+  Mark all writeable entries in a process's page table as copy-on-write
 */
 
-void setCopyOnWrite(PageTable *table, int is_child) {
+void setCopyOnWrite(ProcessDescriptor *process, int is_child) {
+    PageTable *table = process->page_table;
 
     TracePrintf(3, "Setting copy-on-write bit\n");
 
@@ -81,6 +96,7 @@ void setCopyOnWrite(PageTable *table, int is_child) {
         long options = PTE_VALID | (old_entry.perm << 1) | (old_entry.misc << 4);
         if (options & PTE_PERM_WRITE) {
             options = (options & ~PTE_PERM_WRITE) | PTE_COPY_ON_WRITE;
+            process->memory.cow_pending++;
         }
 
         // If I'm the child, then I need to increment the frc for any writeable pages
@@ -91,7 +107,7 @@ void setCopyOnWrite(PageTable *table, int is_child) {
         table->entries[i] = createPTEWithOptions(options, old_entry.pfn);
     }
 
-    WriteRegister(REG_TLB_FLUSH, TLB_FLUSH_1);
+    flushTLB(TLB_FLUSH_1);
 }
 
 
@@ -112,16 +128,11 @@ ProcessDescriptor* createProcessDescriptor() {
     processDescriptorInit(process);
     if (process->pid == 0) { free(process); return 0; }
 
-    // Try to allocate space for a new process control block
-    for (int i=0; i<indexOfPage(KERNEL_STACK_MAXSIZE); i++) {
-        process->pcb_frames[i] = allocatePageFrame();
-        
-        // If there wasn't enough room, free any page frames we've already allocated
-        if (!process->pcb_frames[i]) {
-        	for (int j=i; j>=0; j--) { freePageFrame(process->pcb_frames[j]); }
-        	free(process);
-        	return 0;
-        }
+    // Try to grab a kernel stack for the new process control block
+    if (allocateKernelStack(process->pcb_frames) == ERROR) {
+        releasePID(process->pid);
+        free(process);
+        return 0;
     }
 
     // Create the ProcessInfo struct at the bottom of the stack
@@ -136,6 +147,39 @@ ProcessDescriptor* createProcessDescriptor() {
 
 
 
+/*
+  Get the link that the children of a process point at, creating it the first
+  time the process forks
+*/
+
+ParentLink* getChildLink(ProcessDescriptor *process) {
+    if (process->child_link) return process->child_link;
+
+    ParentLink *link = (ParentLink *) malloc(sizeof(ParentLink));
+    if (!link) return 0;
+
+    link->process = process;
+    link->references = 1;
+    process->child_link = link;
+
+    return link;
+}
+
+
+
+
+/*
+  Drop a reference to a parent link, and free it once nobody is using it
+*/
+
+void dropParentLink(ParentLink *link) {
+    if (!link) return;
+    if (--link->references == 0) free(link);
+}
+
+
+
+
 /*  
   Delay the calling process for the given number of clock ticks
 */
@@ -159,23 +203,34 @@ int delayProcess(int ticks) {
 
 
 /*
-  Wait for a child to exit before returning
+  Wait for a child to exit before returning. A pid of 1 means any child will do.
 */
 
 int waitForPID(unsigned long pid, int *status) {
+    ProcessDescriptor *process = getCurrentProcess();
     ProcessDescriptor *current;
+    void *data = (void *) pid;
 
     // Make sure we actually have some children
-    if (listIsEmpty(&getCurrentProcess()->children)) return -1;
+    if (listIsEmpty(&process->children) && listIsEmpty(&process->zombies)) return -1;
 
-    // Loop through our children until we find a zombie
-    while (1) {
-        forEachElement(current, &getCurrentProcess()->children, siblings) {
-            if (current->state == PROCESS_ZOMBIE && (current->pid == pid || pid == 1)) goto done;
-        }
-        schedule();
+    // If we're waiting on a specific child, we can look it up directly
+    if (pid != 1) {
+        current = getProcessWithPID(pid);
+        if (!current || getParentProcess(current) != process || current->thread_leader) return -1;
+        if (current->state == PROCESS_ZOMBIE) goto done;
     }
 
+    // Otherwise, take the first child that has already exited, if there is one
+    else if (!listIsEmpty(&process->zombies)) {
+        current = elementForNode(process->zombies.next, ProcessDescriptor, siblings);
+        goto done;
+    }
+
+    // If not, sleep until the child we're after hands itself to us
+    if (sleepOnWaitQueueWithData(&process->exit_queue, &data)) return -1;
+    current = (ProcessDescriptor *) data;
+
     // Then return its status
     done:
     *status = current->exit_status;
@@ -191,21 +246,18 @@ int waitForPID(unsigned long pid, int *status) {
 */
 
 int joinThread(unsigned long thread_id) {
-    ProcessDescriptor *current;
+    void *data = (void *) thread_id;
 
-    // Make sure we actually have some child threads
-    if (listIsEmpty(&getCurrentProcess()->thread_group)) return -1;
+    // Look up the thread and make sure it's actually one of ours
+    ProcessDescriptor *thread = getProcessWithPID(thread_id);
+    if (!thread || thread->thread_leader != getCurrentProcess()) return -1;
 
-    // Loop through our child threads until we find a zombie
-    while (1) {
-        forEachElement(current, &getCurrentProcess()->thread_group, thread_peers) {
-            if (current->state == PROCESS_ZOMBIE && current->pid == thread_id) goto done;
-        }
-        schedule();
+    // If it hasn't exited yet, sleep until it hands itself to us
+    if (thread->state != PROCESS_ZOMBIE) {
+        if (sleepOnWaitQueueWithData(&getCurrentProcess()->exit_queue, &data)) return -1;
     }
 
-    // Then return its status
-    done:
-    releaseProcess(current);
+    // Then release it
+    releaseProcess(thread);
     return 0;
 }
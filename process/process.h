@@ -19,8 +19,10 @@
 #include <string.h>
 
 #include "../include/hardware.h"
+#include "../include/custom.h"
 #include "../memory/memory.h"
 #include "../core/list.h"
+#include "../sync/waitqueue.h"
 
 
 
@@ -36,16 +38,44 @@
 #define KILL (-2)
 #define SUCCESS 0
 
-extern long max_pid;
+
+// The low and high watermarks for the pool of free kernel stacks
+#ifndef KERNEL_STACK_POOL_LOW
+#define KERNEL_STACK_POOL_LOW 4
+#endif
+
+#ifndef KERNEL_STACK_POOL_HIGH
+#define KERNEL_STACK_POOL_HIGH 16
+#endif
+
+// The number of orphaned zombies the idle process releases on each clock tick
+#ifndef ORPHAN_REAP_BATCH
+#define ORPHAN_REAP_BATCH 8
+#endif
+
+// The maximum number of live processes. This has to be a power of two.
+#ifndef MAX_PROCESSES
+#define MAX_PROCESSES 1024
+#endif
+
+// The number of service IDs that servers can Register() under
+#ifndef MAX_SERVICES
+#define MAX_SERVICES 16
+#endif
+
 extern LinkedListNode process_head;
 
 
 struct ProcessInfo;
 struct ProcessDescriptor;
+struct ParentLink;
+struct MessageInfo;
 struct WaitQueueNode;
 
 typedef struct ProcessInfo ProcessInfo;
 typedef struct ProcessDescriptor ProcessDescriptor;
+typedef struct ParentLink ParentLink;
+typedef struct MessageInfo MessageInfo;
 
 typedef unsigned int PID;
 
@@ -105,12 +135,83 @@ struct ProcessInfo {
 
 
 
+/*
+  The ParentLink struct lets a process find its parent through one level of
+  indirection. All the children of a process point at the same link, so when the
+  parent exits we can hand every one of them to the idle process by updating a
+  single pointer, rather than visiting each child.
+
+  process:      The process that currently owns the children pointing at this link
+  references:   The number of children pointing at this link, plus one for the
+                process that created it
+*/
+
+struct ParentLink {
+    ProcessDescriptor *process;
+    long references;
+};
+
+
+
+
+/*
+  The MessageState enum describes where a process is in a message exchange.
+
+  MESSAGE_IDLE:     The process isn't sending or receiving anything
+  MESSAGE_SENDING:  The process is waiting on its receiver's senders list for the
+                    receiver to pick up its message
+  MESSAGE_REPLYING: The receiver has picked up the message, and the process is
+                    waiting for it to Reply
+  MESSAGE_RECEIVING: The process is sleeping in Receive until a message arrives
+*/
+
+enum MessageState {
+    MESSAGE_IDLE=0,
+    MESSAGE_SENDING,
+    MESSAGE_REPLYING,
+    MESSAGE_RECEIVING
+};
+
+
+
+
+/*
+  The MessageInfo struct keeps track of a process's message passing state. See
+  message.c for how a message exchange works.
+
+  state:        Where the process is in the exchange
+  buffer:       The user buffer passed to Send, or to Receive while we're waiting
+  partner:      The process we're sending to or waiting on a reply from. While
+                receiving, the process we want a message from (or 0 for anyone)
+  status:       The value Send returns once the process wakes up
+  senders:      The head of the list of processes waiting for us to receive
+  replies:      The head of the list of processes waiting for us to reply
+  node:         A linked list node that can be hooked onto the partner's senders
+                or replies list
+*/
+
+struct MessageInfo {
+    enum MessageState state;
+    void *buffer;
+    PID partner;
+    long status;
+
+    LinkedListNode senders;
+    LinkedListNode replies;
+    LinkedListNode node;
+};
+
+
+
+
 /*
   The ProcessDescriptor struct contains all of the important information about a
   process.
 
-  pid:          The unique ID of the process. Ranges from 0 and PID_MAX
+  pid:          The unique ID of the process. See pid.c for how these get recycled
   wake_up_time: The amount of time we need to wait for the process to wake up
+  woken_at:     The cycle count when we were last taken off a waitqueue, or 0 once
+                we've run since. Used to trace wakeup-to-run latency
   exit_status:  The state that this process exited with
   state:        The current state of the process
 
@@ -118,10 +219,14 @@ struct ProcessInfo {
                 to the Process Control Block, in case we ever need it
 
 
-  parent:       A pointer to the descriptor of our parent, if it's is still around,
-                or the descriptor of process 1 (init) if our parent no longer exists
-  children:     The head of the list containing all of our children
+  parent_link:  The link to our parent, which points at process 1 (init) if our
+                parent no longer exists. Use getParentProcess() to follow it
+  child_link:   The link that our own children point at. Only created once we fork
+  children:     The head of the list containing all of our running children
+  zombies:      The head of the list containing our children that have exited but
+                haven't been waited for yet
   siblings:     A linked list node that can be hooked onto by our parent's child list
+                or zombie list
   
   thread_leader: A pointer to the descriptor of our thread group leader
   thread_group: The head of the list containing all of the threads in our thread_group
@@ -132,8 +237,22 @@ struct ProcessInfo {
                 Useful for iterating through all the processes at once
 
   waitqueue:    A linked list node that can be hooked onto by a waitqueue
+  resources:    The head of the list of sync resources this process owns. These get
+                cleaned up when the process exits
+  held_locks:   The head of the list of LockHolds for the mutexes and reader-writer
+                locks we're holding, whoever created them. These get passed on when
+                the process exits
+  message:      Our state for Send/Receive/Reply message passing
+  exit_queue:   The waitqueue that our children and threads signal when they exit.
+                Wait() and JoinThread() sleep here until a child hands itself over
 
   page_table:   The REGION_1 page table for this process
+  mapped_ranges: The ranges of the page table that our text, data, heap and stack
+                might occupy. Only these ranges get scanned when we free the table
+  memory:       How many of our pages are resident, copy-on-write, heap and stack.
+                These are kept up to date as pages get mapped and unmapped, except
+                for the shared count, which depends on everybody else's mappings and
+                only gets worked out when someone asks (see copyMemoryUsage)
   user_context: The UserContext for this process. We need to save this whenever we
                 switch to kernel mode so we can use it later on to resume the process
   kernel_context: The KernelContext for this process. We need to save this whenever
@@ -144,13 +263,16 @@ struct ProcessDescriptor {
     PID pid;
 
     long wake_up_time;
+    unsigned long long woken_at;
     long exit_status;
 
     enum ProcessState state;
     void *pcb_frames[KERNEL_STACK_MAXSIZE >> PAGESHIFT];
     
-    ProcessDescriptor* parent;
+    ParentLink *parent_link;
+    ParentLink *child_link;
     LinkedListNode children;
+    LinkedListNode zombies;
     LinkedListNode siblings;
 
     ProcessDescriptor* thread_leader;
@@ -159,8 +281,14 @@ struct ProcessDescriptor {
 
     LinkedListNode process_list;
     struct WaitQueueNode *waitqueue;
+    WaitQueue exit_queue;
+    LinkedListNode resources;
+    LinkedListNode held_locks;
+    MessageInfo message;
 
     PageTable *page_table;
+    MappedRange mapped_ranges[NUMBER_OF_MAPPED_RANGES];
+    MemoryUsage memory;
     UserContext user_context;
     KernelContext kernel_context;
 };
@@ -195,9 +323,9 @@ union ProcessControlBlock {
 #define getIdleProcess() \
     elementForNode(process_head.next, ProcessDescriptor, process_list)
 
-// Get the next available process ID
-#define nextAvailablePID() \
-    (max_pid < LONG_MAX ? ++max_pid : 0)
+// Get the parent of a process, following its parent link
+#define getParentProcess(descriptor) \
+    ((descriptor)->parent_link ? (descriptor)->parent_link->process : 0)
 
 
 
@@ -246,19 +374,29 @@ union ProcessControlBlock {
   Some macros to create a new process descriptor
 */
 
+PID allocatePID(ProcessDescriptor *process);
+
 // Dynamically initialize a new linked list node
 static inline void processDescriptorInit(ProcessDescriptor *process) {
     memset(process, 0x00, sizeof(ProcessDescriptor));
     
-    process->pid = nextAvailablePID();
+    process->pid = allocatePID(process);
     process->state = PROCESS_RUNNING;
 
     linkedListNodeInit(&process->children);
+    linkedListNodeInit(&process->zombies);
     linkedListNodeInit(&process->siblings);
     linkedListNodeInit(&process->thread_group);
     linkedListNodeInit(&process->thread_peers);
 
     linkedListNodeInit(&process->process_list);
+    waitQueueInit(&process->exit_queue);
+    linkedListNodeInit(&process->resources);
+    linkedListNodeInit(&process->held_locks);
+
+    linkedListNodeInit(&process->message.senders);
+    linkedListNodeInit(&process->message.replies);
+    linkedListNodeInit(&process->message.node);
 }
 
 
@@ -281,8 +419,21 @@ int forkProcess();
 int loadProgram(char *name, char *args[]);
 
 
+void releasePID(PID pid);
+ProcessDescriptor* getProcessWithPID(PID pid);
+
+
+int allocateKernelStack(void *frames[]);
+void freeKernelStack(void *frames[]);
+void refillKernelStackPool();
+long kernelStackPoolFrames();
+void countPooledStackFrames(unsigned short *references);
+
+
 ProcessDescriptor* createProcessDescriptor();
-void setCopyOnWrite(PageTable *table, int is_child);
+ParentLink* getChildLink(ProcessDescriptor *process);
+void dropParentLink(ParentLink *link);
+void setCopyOnWrite(ProcessDescriptor *process, int is_child);
 void freeAddressSpace(ProcessDescriptor *process);
 int delayProcess(int ticks);
 int waitForPID(unsigned long pid, int *status);
@@ -295,6 +446,18 @@ int joinThread(unsigned long thread_id);
 void killCurrentProcess(int status);
 void killProcess(ProcessDescriptor *process, int status);
 void releaseProcess(ProcessDescriptor *process);
+void reapOrphanedZombies();
+
+
+int registerService(unsigned int service_id);
+int sendMessage(void *message, int pid);
+int receiveMessage(void *message, PID pid);
+int replyToMessage(void *message, int pid);
+int forwardMessage(void *message, int destination_pid, int source_pid);
+int copyFromProcess(int source_pid, void *destination, void *source, int length);
+int copyToProcess(int destination_pid, void *destination, void *source, int length);
+int prepareUserRange(ProcessDescriptor *process, void *address, long length, int writing);
+void cancelMessages(ProcessDescriptor *process);
 
 
 
@@ -0,0 +1,135 @@
+/*
+  File: stack.c
+  Date: 10/19/2026
+  Author: Mitchell Goff
+*/
+
+
+/* =============================== *
+
+             Includes
+
+ * =============================== */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "../include/hardware.h"
+#include "../memory/memory.h"
+#include "process.h"
+
+
+
+
+/* =============================== *
+
+               Data
+
+ * =============================== */
+
+/*
+  The kernel stack pool keeps the page frames of recently released kernel stacks
+  around so that new processes and threads can reuse them without going through
+  the frame allocator. Each entry holds a full set of kernel stack frames.
+*/
+
+static void *stack_pool[KERNEL_STACK_POOL_HIGH][KERNEL_STACK_MAXSIZE >> PAGESHIFT];
+static int stack_pool_size = 0;
+
+
+
+
+/* =============================== *
+
+           Implementation
+
+ * =============================== */
+
+// Allocate every frame of a kernel stack from the frame allocator
+static int allocateStackFrames(void *frames[]) {
+	for (int i=0; i<indexOfPage(KERNEL_STACK_MAXSIZE); i++) {
+		frames[i] = allocatePageFrame();
+
+		// If there wasn't enough room, free any page frames we've already allocated
+		if (!frames[i]) {
+			for (int j=i-1; j>=0; j--) { freePageFrame(frames[j]); }
+			return ERROR;
+		}
+	}
+
+	return SUCCESS;
+}
+
+
+
+
+/*
+  Fill in $frames with the page frames for a new kernel stack. We take a stack
+  from the pool if there is one, and only fall back on the frame allocator when
+  the pool has run dry.
+*/
+
+int allocateKernelStack(void *frames[]) {
+
+	// If there's a stack in the pool, just hand it out
+	if (stack_pool_size > 0) {
+		stack_pool_size--;
+		memcpy(frames, stack_pool[stack_pool_size], sizeof(stack_pool[0]));
+		return SUCCESS;
+	}
+
+	// Otherwise, allocate the frames one by one
+	return allocateStackFrames(frames);
+}
+
+
+
+
+/*
+  Give the page frames of a kernel stack back. If the pool is already at its
+  high watermark, the frames go straight back to the frame allocator.
+*/
+
+void freeKernelStack(void *frames[]) {
+	if (stack_pool_size < KERNEL_STACK_POOL_HIGH) {
+		memcpy(stack_pool[stack_pool_size], frames, sizeof(stack_pool[0]));
+		stack_pool_size++;
+		return;
+	}
+
+	freePageFrames(frames, indexOfPage(KERNEL_STACK_MAXSIZE));
+}
+
+
+
+
+/*
+  Top the pool back up to its low watermark. This gets called from the clock
+  handler, so that the refill cost is paid outside of Fork and CreateThread.
+*/
+
+void refillKernelStackPool() {
+	while (stack_pool_size < KERNEL_STACK_POOL_LOW) {
+		// If we're out of frames, just try again on the next tick
+		if (allocateStackFrames(stack_pool[stack_pool_size]) == ERROR) return;
+		stack_pool_size++;
+	}
+}
+
+
+
+
+// The number of page frames sitting in the pool, for checking for leaks
+long kernelStackPoolFrames() {
+	return stack_pool_size * indexOfPage(KERNEL_STACK_MAXSIZE);
+}
+
+
+
+
+// Add a reference to $references for every frame in the pool, for the memory checker
+void countPooledStackFrames(unsigned short *references) {
+	for (int s=0; s<stack_pool_size; s++) {
+		for (int i=0; i<indexOfPage(KERNEL_STACK_MAXSIZE); i++) references[indexOfPage(stack_pool[s][i])]++;
+	}
+}
@@ -61,6 +61,46 @@ KernelContext* cloneKernelContext(KernelContext *context, void *a, void *b) {
 
 
 
+/*
+  Helpers for the scheduler trace
+*/
+
+// Figure out why $process is giving up the CPU
+static int switchReason(ProcessDescriptor *process) {
+	if (process->state == PROCESS_ZOMBIE || process->state == PROCESS_DEAD) return TRACE_SWITCH_EXIT;
+	if (process->state == PROCESS_WAITING) return TRACE_SWITCH_BLOCK;
+	if (process->wake_up_time > elapsed_clock_ticks) return TRACE_SWITCH_DELAY;
+	return TRACE_SWITCH_TICK;
+}
+
+// Count the processes that could run right now. This walks the whole process
+// list, so it only gets called when the scheduler category is being traced,
+// which it isn't by default (see TRACE_DEFAULT_MASK).
+static int countRunnableProcesses() {
+	ProcessDescriptor *process;
+	int count = 0;
+
+	forEachElement(process, &process_head, process_list) {
+		if (process->state == PROCESS_RUNNING && process->wake_up_time <= elapsed_clock_ticks) count++;
+	}
+	return count;
+}
+
+// Record which process is taking over from $pa and why, and how long $pb has been
+// waiting to run since it was woken up
+static void traceSwitch(ProcessDescriptor *pa, ProcessDescriptor *pb) {
+	traceEvent(TRACE_SWITCH, pb->pid, switchReason(pa) | countRunnableProcesses() << 8);
+
+	if (pb->woken_at) {
+		unsigned long long latency = readCycleCounter() - pb->woken_at;
+		traceEvent(TRACE_RUN_LATENCY, pb->pid, latency > 0xFFFFFFFF ? 0xFFFFFFFF : latency);
+		pb->woken_at = 0;
+	}
+}
+
+
+
+
 /*
   Switch to a new kernel context
 */
@@ -71,6 +111,8 @@ KernelContext* switchKernelContext(KernelContext *context, void *a, void *b) {
 
 	// Swap the current kernel context
 	memcpy(&pa->kernel_context, context, sizeof(KernelContext));
+	countStat(context_switches);
+	traceSwitch(pa, pb);
 
 	// Remap the kernel stack
 	for (int i=0; i<indexOfPage(KERNEL_STACK_MAXSIZE); i++) {
@@ -80,7 +122,7 @@ KernelContext* switchKernelContext(KernelContext *context, void *a, void *b) {
 	}
 
 	WriteRegister(REG_PTBR1, (long)pb->page_table);
-	WriteRegister(REG_TLB_FLUSH, TLB_FLUSH_ALL);
+	flushTLB(TLB_FLUSH_ALL);
 
 	return &pb->kernel_context;
 }
@@ -96,17 +138,11 @@ KernelContext* killKernelContext(KernelContext *context, void *a, void *b) {
 	ProcessDescriptor *pa = (ProcessDescriptor *) a, *pb = (ProcessDescriptor *) b;
 	switchKernelContext(context, a, b);
 
-	// Free the page frames containing the kernel stack
-	for (int i=0; i<indexOfPage(KERNEL_STACK_MAXSIZE); i++) {
-		void *frame = pa->pcb_frames[i];
-		freePageFrame(frame);
-	}
+	// Give the page frames containing the kernel stack back to the pool. The
+	// descriptor belongs to whoever reaps us: a waiter, our parent's Wait(), or
+	// reapOrphanedZombies if our parent is init.
+	freeKernelStack(pa->pcb_frames);
 
-	// If the parent has already exited, remove the process descriptor
-	if (pa->thread_leader == 0 && pa->parent->pid == 1) {
-		releaseProcess(pa);
-	}
-	
 	return &pb->kernel_context;
 }
 
@@ -4,7 +4,7 @@
 #include <stdio.h>
 #include <assert.h>
 #include <string.h>
-#include "../list.h"
+#include "../../core/list.h"
 
 
 struct ListElement {
@@ -93,11 +93,11 @@ void testListElements() {
 
 
 	// Try dequeuing a list node
-	assert(removeFirstElement(ListElement, node, &head) == &queue);
+	assert(removeFirstElement(struct ListElement, node, &head) == &queue);
 	assert(head.next == &next.node);
 
 	// Try popping a node
-	assert(removeLastElement(ListElement, node, &head) == &push);
+	assert(removeLastElement(struct ListElement, node, &head) == &push);
 	assert(head.prev == &next.node);
 
 	// Try removing a node
@@ -107,9 +107,29 @@ void testListElements() {
 
 
 
+void testSpliceLists() {
+	newLinkedListNode(first);
+	newLinkedListNode(second);
+
+	newLinkedListNode(a);
+	newLinkedListNode(b);
+	newLinkedListNode(c);
+	addLastNode(&a, &first);
+	addLastNode(&b, &second);
+	addLastNode(&c, &second);
+
+	// Splice $second onto the end of $first
+	spliceLinkedLists(&second, &first);
+	assert(first.next == &a && a.next == &b && b.next == &c && c.next == &first);
+	assert(first.prev == &c && c.prev == &b && b.prev == &a && a.prev == &first);
+}
+
+
+
 int main() {
 	testListNodes();
 	testListElements();
+	testSpliceLists();
 
 	printf("All tests passed!\n");
 	return 0;
@@ -0,0 +1,168 @@
+/* Tests for process.h */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <assert.h>
+#include <string.h>
+
+#include "../../include/yalnix.h"
+#include "../process.h"
+#include "../../sim/sim.h"
+
+
+int status;
+
+
+// Let the clock tick until $process is the one running, which shouldn't take long
+void runAs(ProcessDescriptor *process) {
+	for (int ticks=0; getCurrentProcess() != process; ticks++) {
+		assert(ticks < 100);
+		simTick();
+	}
+}
+
+// Fork a child of the current process, which stays put
+ProcessDescriptor* forkChild() {
+	ProcessDescriptor *parent = getCurrentProcess();
+	long pid = simSyscall(YALNIX_FORK, 0, 0, 0);
+	assert(getCurrentProcess() == parent);
+	return getProcessWithPID(pid);
+}
+
+// Give the current process a fresh page at the top of its heap, which nobody else shares
+char* growHeap() {
+	char *page = (char *) UP_TO_PAGE(((ProcessInfo *) KERNEL_STACK_BASE)->current_brk);
+	assert(simSyscall(YALNIX_BRK, (long) (page + PAGESIZE), 0, 0) == SUCCESS);
+	return page;
+}
+
+
+// Init can Wait for its own children like anyone else
+void testInitWaits(ProcessDescriptor *init) {
+	ProcessDescriptor *child = forkChild();
+	PID pid = child->pid;
+
+	// Block in Wait, so we come back out in the child
+	simSyscall(YALNIX_WAIT, (long) &status, 0, 0);
+	assert(getCurrentProcess() == child);
+	simSyscall(YALNIX_EXIT, 7, 0, 0);
+
+	// The child's exit goes straight to us, and only our Wait releases it
+	assert(getCurrentProcess() == init);
+	assert(sim_user_context.regs[0] == 0);
+	assert(status == 7);
+	assert(getProcessWithPID(pid) == 0);
+	assert(listIsEmpty(&init->children) && listIsEmpty(&init->zombies));
+}
+
+
+// A child of init that nobody waits for gets reaped on the next clock tick
+void testInitReapsOrphans(ProcessDescriptor *init) {
+	ProcessDescriptor *child = forkChild();
+	PID pid = child->pid;
+
+	runAs(child);
+	simSyscall(YALNIX_EXIT, 0, 0, 0);
+	assert(getCurrentProcess() == init);
+	assert(child->state == PROCESS_ZOMBIE && init->zombies.next == &child->siblings);
+
+	simTick();
+	assert(getProcessWithPID(pid) == 0);
+	assert(listIsEmpty(&init->zombies));
+}
+
+
+
+// A freed PID's slot comes back with a new generation, so the old PID stays dead
+void testPIDsAreRecycled() {
+	ProcessDescriptor *processes = (ProcessDescriptor *) calloc(MAX_PROCESSES, sizeof(ProcessDescriptor));
+	PID first = processes[0].pid = allocatePID(&processes[0]);
+	assert(getProcessWithPID(first) == &processes[0]);
+	releasePID(first);
+	assert(getProcessWithPID(first) == 0);
+
+	// Take every slot that's left, so the freed one has to come around again
+	int count = 0, reused = 0;
+	PID pid;
+	while ((pid = allocatePID(&processes[count]))) {
+		processes[count].pid = pid;
+		if (pid % MAX_PROCESSES == first % MAX_PROCESSES) reused = 1;
+		assert(pid != first);
+		count++;
+	}
+	assert(reused && count < MAX_PROCESSES);
+	assert(getProcessWithPID(first) == 0);
+
+	for (int i=0; i<count; i++) releasePID(processes[i].pid);
+	free(processes);
+}
+
+
+// Kernel stacks go back into the pool up to its high watermark, and the clock tops
+// it back up to its low one
+void testStackPool() {
+	void *stacks[KERNEL_STACK_POOL_HIGH + 1][KERNEL_STACK_MAXSIZE >> PAGESHIFT];
+	long frames = indexOfPage(KERNEL_STACK_MAXSIZE);
+	long pooled = kernelStackPoolFrames() / frames;
+	long free_frames = countFreeFrames();
+
+	// The first few come out of the pool, and the rest from the frame allocator
+	for (int i=0; i<=KERNEL_STACK_POOL_HIGH; i++) assert(allocateKernelStack(stacks[i]) == SUCCESS);
+	assert(kernelStackPoolFrames() == 0);
+	assert(countFreeFrames() == free_frames - (KERNEL_STACK_POOL_HIGH + 1 - pooled) * frames);
+
+	simTick();
+	assert(kernelStackPoolFrames() == KERNEL_STACK_POOL_LOW * frames);
+
+	// The pool only keeps as many as its high watermark
+	for (int i=0; i<=KERNEL_STACK_POOL_HIGH; i++) freeKernelStack(stacks[i]);
+	assert(kernelStackPoolFrames() == KERNEL_STACK_POOL_HIGH * frames);
+	assert(countFreeFrames() == free_frames - (KERNEL_STACK_POOL_HIGH - pooled) * frames);
+}
+
+
+// A message goes from the sender's buffer to the receiver's, and the reply comes back in its place
+void testMessagePassing(ProcessDescriptor *init) {
+	ProcessDescriptor *child = forkChild();
+	assert(simSyscall(YALNIX_SEND, (long) growHeap(), 0x7FFFFF, 0) == ERROR);
+
+	// Block in Send, since we aren't receiving yet
+	runAs(child);
+	char *message = growHeap();
+	strcpy(message, "ping");
+	simSyscall(YALNIX_SEND, (long) message, init->pid, 0);
+	assert(child->state == PROCESS_WAITING);
+
+	runAs(init);
+	char *buffer = growHeap();
+	assert(simSyscall(YALNIX_RECEIVE, (long) buffer, 0, 0) == child->pid);
+	assert(strcmp(buffer, "ping") == 0);
+
+	// Replying switches straight back to the sender
+	strcpy(buffer, "pong");
+	simSyscall(YALNIX_REPLY, (long) buffer, child->pid, 0);
+	assert(getCurrentProcess() == child);
+	assert(sim_user_context.regs[0] == SUCCESS);
+	assert(strcmp(message, "pong") == 0);
+	simSyscall(YALNIX_EXIT, 0, 0, 0);
+
+	runAs(init);
+	assert(simSyscall(YALNIX_WAIT, (long) &status, 0, 0) == 0);
+}
+
+
+
+int main() {
+	simBoot(NULL);
+	ProcessDescriptor *init = getCurrentProcess();
+	assert(init == getIdleProcess());
+
+	testInitWaits(init);
+	testInitReapsOrphans(init);
+	testPIDsAreRecycled();
+	testStackPool();
+	testMessagePassing(init);
+
+	printf("All tests passed!\n");
+	return 0;
+}
@@ -0,0 +1,170 @@
+/* Stress tests for the allocation failure paths, under fault injection */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <assert.h>
+#include <string.h>
+
+#include "../../include/yalnix.h"
+#include "../process.h"
+#include "../../memory/memory.h"
+#include "../../sim/sim.h"
+
+#define STRESS_ROUNDS 1500
+#define STRESS_FAULT_RATE 5
+#define STRESS_BRK_PAGES 16
+#define STRESS_CHECK_EVERY 100
+
+// Pass a seed on the command line to replay a run
+#define STRESS_DEFAULT_SEED 0x5EED
+
+ProcessDescriptor *driver;
+unsigned int random_state;
+int status;
+char *exec_args[2];
+
+
+unsigned int nextRandom() {
+	random_state ^= random_state << 13;
+	random_state ^= random_state >> 17;
+	random_state ^= random_state << 5;
+	return random_state;
+}
+
+
+// Frames that nobody is using: the free list plus the kernel stack pool
+long idleFrames() {
+	return free_frames + kernelStackPoolFrames();
+}
+
+long currentBrk() {
+	return (long)((ProcessInfo *) KERNEL_STACK_BASE)->current_brk;
+}
+
+long heapStart() {
+	return (long)((ProcessInfo *) KERNEL_STACK_BASE)->heap_start;
+}
+
+
+// Let the clock tick until $process is the one running
+void runAs(ProcessDescriptor *process) {
+	while (getCurrentProcess() != process) simTick();
+}
+
+
+// These run inside the kernel, on behalf of the driver
+void killOther(void *process) {
+	killProcess((ProcessDescriptor *) process, 0);
+}
+
+void injectFaults(void *rate) {
+	setFaultInjection(FAULT_ALL, (unsigned int)(long) rate, nextRandom());
+}
+
+
+
+// A failed fork shouldn't leave anything behind, and a child should give everything back
+void stressFork() {
+	long pid = simSyscall(YALNIX_FORK, 0, 0, 0);
+	assert(getCurrentProcess() == driver);
+	if (pid == ERROR) return;
+
+	simRunInKernel(killOther, getProcessWithPID(pid));
+	assert(simSyscall(YALNIX_WAIT, (long) &status, 0, 0) == 0);
+}
+
+
+void stressThread() {
+	long tid = simSyscall(YALNIX_CUSTOM_0, 0, 0, 0);
+	assert(getCurrentProcess() == driver);
+	if (tid == ERROR) return;
+
+	simRunInKernel(killOther, getProcessWithPID(tid));
+	assert(simSyscall(YALNIX_CUSTOM_1, tid, 0, 0) == 0);
+}
+
+
+// Either the heap moves where we asked, or it stays exactly as it was
+void stressBrk() {
+	long before = currentBrk();
+	long target = heapStart() + (nextRandom() % STRESS_BRK_PAGES) * PAGESIZE;
+
+	long result = simSyscall(YALNIX_BRK, target, 0, 0);
+	assert(currentBrk() == (result == ERROR ? before : target));
+	assert(driver->memory.heap == (currentBrk() - heapStart()) >> PAGESHIFT);
+	assert(driver->mapped_ranges[RANGE_HEAP].end == indexOfPage(currentBrk() - VMEM_1_BASE));
+}
+
+
+// Exec in a child, which gets killed if the exec fails after its old image is gone
+void stressExec() {
+	long pid = simSyscall(YALNIX_FORK, 0, 0, 0);
+	if (pid == ERROR) return;
+	ProcessDescriptor *child = getProcessWithPID(pid);
+
+	runAs(child);
+	simSyscall(YALNIX_EXEC, (long) exec_args[0], (long) exec_args, 0);
+	if (getCurrentProcess() == child) simSyscall(YALNIX_EXIT, 0, 0, 0);
+
+	runAs(driver);
+	assert(simSyscall(YALNIX_WAIT, (long) &status, 0, 0) == 0);
+}
+
+
+
+// Make sure the kernel's bookkeeping is consistent, and nothing has gone missing
+void checkFrames(long baseline) {
+	assert(countFreeFrames() == free_frames);
+	assert(checkMemoryInvariants() == 0);
+	assert(idleFrames() + driver->memory.heap == baseline);
+}
+
+
+
+int main(int argc, char *argv[]) {
+	unsigned int seed = argc > 1 ? strtoul(argv[1], NULL, 0) : STRESS_DEFAULT_SEED;
+	random_state = seed ? seed : 1;
+	printf("Stress testing with seed %#x\n", seed);
+
+	simBoot(NULL);
+	exec_args[0] = simProgramName();
+
+	// Init reaps its zombies by itself, so the workloads run in a child of it
+	long pid = simSyscall(YALNIX_FORK, 0, 0, 0);
+	driver = getProcessWithPID(pid);
+	runAs(driver);
+
+	// Everything the driver's heap doesn't account for should come back by the end
+	long baseline = idleFrames();
+	checkFrames(baseline);
+
+	int counts[4] = {0, 0, 0, 0};
+	for (int round=0; round<STRESS_ROUNDS; round++) {
+		simRunInKernel(injectFaults, (void *) STRESS_FAULT_RATE);
+
+		int op = nextRandom() % 4;
+		counts[op]++;
+		switch (op) {
+			case 0: stressFork(); break;
+			case 1: stressThread(); break;
+			case 2: stressBrk(); break;
+			case 3: stressExec(); break;
+		}
+
+		simRunInKernel(injectFaults, (void *) 0);
+		if (round % STRESS_CHECK_EVERY == 0) checkFrames(baseline);
+	}
+
+	printf("Ran %d forks, %d threads, %d brks and %d execs, with %lu faults injected\n",
+		counts[0], counts[1], counts[2], counts[3], kernel_stats.faults_injected);
+	assert(kernel_stats.faults_injected > 0);
+
+	// With injection off, shrink the heap back and make sure every frame came home
+	assert(simSyscall(YALNIX_BRK, heapStart(), 0, 0) == 0);
+	assert(driver->memory.heap == 0);
+	assert(listIsEmpty(&driver->children) && listIsEmpty(&driver->zombies));
+	checkFrames(baseline);
+
+	printf("All tests passed!\n");
+	return 0;
+}
@@ -0,0 +1,603 @@
+/*
+  File: hardware.c
+  Date: 10/19/2026
+  Author: Mitchell Goff
+*/
+
+
+/* =============================== *
+
+             Includes
+
+ * =============================== */
+
+#include "../include/hardware.h"
+#include "../include/load_info.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+#include <signal.h>
+#include <malloc.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+
+#include "sim.h"
+
+
+
+
+/* =============================== *
+
+               Data
+
+ * =============================== */
+
+/*
+  Physical memory is a memfd, and the TLB is the set of pages in the simulated
+  address range that currently have a piece of it mapped in. Every page starts out
+  inaccessible, so the first touch after a flush faults, and the fault handler walks
+  the page tables (or maps the page straight through, if virtual memory is off)
+  exactly like a TLB miss would. This means that a PTE change only shows up after
+  the kernel flushes it, just like on the real hardware.
+
+  The host kernel refuses to map anything in the first few pages of memory, so the
+  simulated range starts at the kernel data segment. Nothing below it ever gets
+  touched, since the kernel text lives on the host.
+*/
+
+#define SIM_MEMORY_BASE SIM_KERNEL_DATA
+#define SIM_MEMORY_LIMIT (SIM_PMEM_SIZE > VMEM_1_LIMIT ? SIM_PMEM_SIZE : VMEM_1_LIMIT)
+
+#define SIM_STACK_SIZE 0x10000
+#define SIM_PROGRAM_PAGES 2
+
+#ifndef MAP_FIXED_NOREPLACE
+#define MAP_FIXED_NOREPLACE 0x100000
+#endif
+
+typedef void (*InterruptHandler) (UserContext *);
+
+static int physical_memory = -1;
+static char tlb[SIM_MEMORY_LIMIT >> PAGESHIFT];
+static unsigned long registers[REG_PTLR1 + 1];
+static int trace_level = 0;
+
+UserContext sim_user_context;
+
+// Host contexts for the test driver, trap entry and KernelContextSwitch
+static ucontext_t driver_context;
+static ucontext_t entry_context;
+static ucontext_t switch_context;
+
+static char entry_signal_stack[SIM_STACK_SIZE];
+static char switch_stack[SIM_STACK_SIZE];
+
+static void (*entry_function) (void *);
+static void *entry_argument;
+
+static KCSFunc_t *switch_function;
+static KernelContext *switch_current;
+static void *switch_a, *switch_b;
+
+// The devices
+static struct {
+	char *output;
+	int output_length;
+	int transmitting;
+
+	char input[TERMINAL_MAX_LINE];
+	int input_length;
+} terminals[NUM_TERMINALS];
+
+static char disk[NUMSECTORS][SECTORSIZE];
+static int disk_busy = 0;
+
+static char program_name[] = "/tmp/yalnix-sim-XXXXXX";
+
+
+
+
+/* =============================== *
+
+          Helper Functions
+
+ * =============================== */
+
+// Print an error and kill the simulator. This can be called from the fault handler.
+static void simFatal(char *format, ...) {
+	static char message[256];
+	va_list args;
+
+	va_start(args, format);
+	int length = vsnprintf(message, sizeof(message), format, args);
+	va_end(args);
+
+	if (length > (int) sizeof(message)) length = sizeof(message);
+	if (write(STDERR_FILENO, message, length) < 0) abort();
+	abort();
+}
+
+
+
+
+// Throw away every translation in [start, end)
+static void flushRange(unsigned long start, unsigned long end) {
+	if (start < SIM_MEMORY_BASE) start = SIM_MEMORY_BASE;
+	if (end > SIM_MEMORY_LIMIT) end = SIM_MEMORY_LIMIT;
+	if (start >= end) return;
+
+	// Clear the TLB first, since we might be flushing our own stack, in which case
+	// it gets faulted straight back in before mmap even returns
+	memset(&tlb[start >> PAGESHIFT], 0x00, (end - start) >> PAGESHIFT);
+
+	void *result = mmap((void *) start, end - start, PROT_NONE,
+		MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED | MAP_NORESERVE, -1, 0);
+	if (result == MAP_FAILED) simFatal("sim: couldn't flush %lX-%lX\n", start, end);
+}
+
+
+
+
+/*
+  Handle a TLB miss. If the page is already in the TLB, then the access must have
+  broken the page's protection, and there's no user mode to send a TRAP_MEMORY to,
+  so the kernel made a mistake.
+*/
+
+static void handleFault(int signal, siginfo_t *info, void *host_context) {
+	unsigned long address = (unsigned long) info->si_addr;
+	unsigned long page = DOWN_TO_PAGE(address);
+	long pfn = page >> PAGESHIFT;
+	int protection = PROT_READ | PROT_WRITE;
+
+	if (address < SIM_MEMORY_BASE || address >= SIM_MEMORY_LIMIT) {
+		simFatal("sim: segmentation fault at %lX\n", address);
+	}
+	if (tlb[page >> PAGESHIFT]) {
+		simFatal("sim: protection violation at %lX\n", address);
+	}
+
+	// With virtual memory enabled, look the page up in the right page table
+	if (registers[REG_VM_ENABLE]) {
+		if (address >= VMEM_1_LIMIT) simFatal("sim: %lX isn't in REGION_0 or REGION_1\n", address);
+
+		int region = (address >= VMEM_1_BASE);
+		struct pte *table = (struct pte *) registers[region ? REG_PTBR1 : REG_PTBR0];
+		unsigned long index = (address - (region ? VMEM_1_BASE : VMEM_0_BASE)) >> PAGESHIFT;
+
+		if (!table || index >= registers[region ? REG_PTLR1 : REG_PTLR0] || !table[index].valid) {
+			simFatal("sim: no valid PTE for %lX\n", address);
+		}
+
+		pfn = table[index].pfn;
+		protection = table[index].prot & (PROT_READ | PROT_WRITE);
+	}
+
+	if (pfn >= (SIM_PMEM_SIZE >> PAGESHIFT)) {
+		simFatal("sim: %lX maps to frame %lX, which doesn't exist\n", address, pfn);
+	}
+
+	void *result = mmap((void *) page, PAGESIZE, protection, MAP_SHARED | MAP_FIXED,
+		physical_memory, pfn << PAGESHIFT);
+	if (result == MAP_FAILED) simFatal("sim: couldn't map %lX\n", address);
+
+	tlb[page >> PAGESHIFT] = 1;
+}
+
+
+
+
+// Write out an executable image that LoadInfo will accept
+static void createProgramImage() {
+	int fd = mkstemp(program_name);
+	if (fd < 0) simFatal("sim: couldn't create %s\n", program_name);
+
+	static char page[PAGESIZE];
+	for (int i=0; i<SIM_PROGRAM_PAGES; i++) {
+		if (write(fd, page, PAGESIZE) != PAGESIZE) simFatal("sim: couldn't write %s\n", program_name);
+	}
+
+	close(fd);
+}
+
+static void removeProgramImage() {
+	unlink(program_name);
+}
+
+
+
+
+// Run the function from enterKernel on the kernel stack, then return to user mode
+static void runKernelEntry() {
+	void (*function) (void *) = entry_function;
+	void *argument = entry_argument;
+
+	function(argument);
+	setcontext(&driver_context);
+}
+
+
+
+
+/*
+  Start running $function on the kernel stack of the current process. We return here
+  whenever some process's kernel entry finishes, which isn't necessarily the one we
+  just started.
+*/
+
+static void enterKernel(void (*function) (void *), void *argument) {
+	entry_function = function;
+	entry_argument = argument;
+
+	getcontext(&entry_context);
+	entry_context.uc_stack.ss_sp = (void *) KERNEL_STACK_BASE;
+	entry_context.uc_stack.ss_size = KERNEL_STACK_MAXSIZE;
+	entry_context.uc_link = NULL;
+	makecontext(&entry_context, runKernelEntry, 0);
+
+	swapcontext(&driver_context, &entry_context);
+}
+
+
+
+
+// Call the handler for a trap out of the interrupt vector
+static void runTrapHandler(void *vector) {
+	InterruptHandler *interrupt_vector = (InterruptHandler *) (long) registers[REG_VECTOR_BASE];
+	InterruptHandler handler = interrupt_vector[(long) vector];
+	if (!handler) simFatal("sim: no handler for trap %ld\n", (long) vector);
+
+	sim_user_context.vector = (long) vector;
+	handler(&sim_user_context);
+}
+
+static void runKernelStart(void *cmd_args) {
+	KernelStart((char **) cmd_args, SIM_PMEM_SIZE, &sim_user_context);
+}
+
+
+
+
+// Call the function passed to KernelContextSwitch on a stack of its own
+static void runSwitchFunction() {
+	KernelContext *next = switch_function(switch_current, switch_a, switch_b);
+
+	// The kernel copies contexts around, so make sure the FPU state points at this copy
+	#if defined(__x86_64__)
+		next->uc_mcontext.fpregs = &next->__fpregs_mem;
+	#endif
+
+	setcontext(next);
+}
+
+
+
+
+
+/* =============================== *
+
+         Hardware Operations
+
+ * =============================== */
+
+void WriteRegister(int reg, unsigned int value) {
+	if (reg < REG_VECTOR_BASE || reg > REG_PTLR1) simFatal("sim: no register %d\n", reg);
+
+	if (reg == REG_TLB_FLUSH) {
+		switch ((int) value) {
+			case TLB_FLUSH_ALL: flushRange(0, SIM_MEMORY_LIMIT); break;
+			case TLB_FLUSH_0: flushRange(VMEM_0_BASE, VMEM_0_LIMIT); break;
+			case TLB_FLUSH_1: flushRange(VMEM_1_BASE, VMEM_1_LIMIT); break;
+			default: flushRange(DOWN_TO_PAGE(value), DOWN_TO_PAGE(value) + PAGESIZE); break;
+		}
+		return;
+	}
+
+	registers[reg] = value;
+
+	// Turning on virtual memory changes every translation
+	if (reg == REG_VM_ENABLE) flushRange(0, SIM_MEMORY_LIMIT);
+}
+
+unsigned int ReadRegister(int reg) {
+	if (reg < REG_VECTOR_BASE || reg > REG_PTLR1) simFatal("sim: no register %d\n", reg);
+	return registers[reg];
+}
+
+
+
+
+void TracePrintf(int level, char *format, ...) {
+	if (level > trace_level) return;
+
+	va_list args;
+	va_start(args, format);
+	vfprintf(stderr, format, args);
+	va_end(args);
+}
+
+void Halt() {
+	fprintf(stderr, "sim: the machine was halted\n");
+	exit(1);
+}
+
+void Pause() {
+	// pass
+}
+
+
+
+
+/*
+  The terminals. Output piles up until the test collects it with simTtyOutput, and
+  the transmit interrupt goes off on the next clock tick.
+*/
+
+void TtyTransmit(int tty, void *buffer, int length) {
+	if (tty < 0 || tty >= NUM_TERMINALS) simFatal("sim: no terminal %d\n", tty);
+	if (terminals[tty].transmitting) simFatal("sim: terminal %d is already transmitting\n", tty);
+
+	char *output = (char *) realloc(terminals[tty].output, terminals[tty].output_length + length);
+	if (!output) simFatal("sim: out of memory\n");
+
+	memcpy(output + terminals[tty].output_length, buffer, length);
+	terminals[tty].output = output;
+	terminals[tty].output_length += length;
+	terminals[tty].transmitting = 1;
+}
+
+int TtyReceive(int tty, void *buffer, int length) {
+	if (tty < 0 || tty >= NUM_TERMINALS) simFatal("sim: no terminal %d\n", tty);
+
+	if (length > terminals[tty].input_length) length = terminals[tty].input_length;
+	memcpy(buffer, terminals[tty].input, length);
+
+	terminals[tty].input_length -= length;
+	memmove(terminals[tty].input, terminals[tty].input + length, terminals[tty].input_length);
+
+	return length;
+}
+
+
+
+
+// The disk finishes every request right away, and interrupts on the next tick
+void DiskAccess(int operation, int sector, void *buffer) {
+	if (sector < 0 || sector >= NUMSECTORS) simFatal("sim: no disk sector %d\n", sector);
+
+	if (operation == DISK_READ) memcpy(buffer, disk[sector], SECTORSIZE);
+	else if (operation == DISK_WRITE) memcpy(disk[sector], buffer, SECTORSIZE);
+	else simFatal("sim: bad disk operation %d\n", operation);
+
+	disk_busy = 1;
+}
+
+
+
+
+int KernelContextSwitch(KCSFunc_t *function, void *a, void *b) {
+	KernelContext current;
+
+	switch_function = function;
+	switch_current = &current;
+	switch_a = a;
+	switch_b = b;
+
+	getcontext(&switch_context);
+	switch_context.uc_stack.ss_sp = switch_stack;
+	switch_context.uc_stack.ss_size = sizeof(switch_stack);
+	switch_context.uc_link = NULL;
+	makecontext(&switch_context, runSwitchFunction, 0);
+
+	// We come back here when somebody switches back to this context
+	if (swapcontext(&current, &switch_context) < 0) return -1;
+	return 0;
+}
+
+
+
+
+/*
+  Every program "loads" the same way, as one page of text followed by one page of
+  data. Nothing ever runs it, since the test does all of the user's work.
+*/
+
+int LoadInfo(int fd, struct load_info *info) {
+	struct stat status;
+	if (fstat(fd, &status) < 0 || status.st_size < SIM_PROGRAM_PAGES * PAGESIZE) return LI_FORMAT_ERROR;
+
+	memset(info, 0x00, sizeof(struct load_info));
+	info->entry = VMEM_1_BASE;
+
+	info->t_faddr = 0;
+	info->t_vaddr = VMEM_1_BASE;
+	info->t_npg = 1;
+	info->t_end = VMEM_1_BASE + PAGESIZE;
+
+	info->id_faddr = PAGESIZE;
+	info->id_vaddr = VMEM_1_BASE + PAGESIZE;
+	info->id_npg = 1;
+	info->id_end = VMEM_1_BASE + 2*PAGESIZE;
+
+	info->ud_vaddr = info->id_end;
+	info->ud_npg = 0;
+	info->ud_end = info->id_end;
+
+	return LI_NO_ERROR;
+}
+
+
+
+
+/*
+  The host kernel won't take a fault on the simulator's behalf, so touch every page
+  of the buffer first to get it into the TLB. loadProgram reads programs straight
+  into REGION_1 with this.
+*/
+
+ssize_t read(int fd, void *buffer, size_t count) {
+	for (unsigned long page = DOWN_TO_PAGE(buffer); page < (unsigned long) buffer + count; page += PAGESIZE) {
+		if (page >= SIM_MEMORY_BASE && page < SIM_MEMORY_LIMIT) (void) *(volatile char *) page;
+	}
+
+	return syscall(SYS_read, fd, buffer, count);
+}
+
+
+
+
+
+/* =============================== *
+
+           Test Interface
+
+ * =============================== */
+
+/*
+  Power on the machine and run KernelStart. When this returns, the kernel has gone
+  to user mode in init, which runs $cmd_args[0] (or an empty program by default).
+*/
+
+void simBoot(char *cmd_args[]) {
+	char *trace = getenv("YALNIX_TRACE");
+	if (trace) trace_level = atoi(trace);
+
+	// Registers are only 32 bits wide, so the kernel heap has to live below 4G
+	mallopt(M_MMAP_MAX, 0);
+	void *probe = malloc(1);
+	if ((unsigned long) probe > 0xFFFFFFFFUL || (unsigned long) &registers > 0xFFFFFFFFUL) {
+		simFatal("sim: the kernel has to be linked below 4G\n");
+	}
+	free(probe);
+
+	// Set up physical memory and the TLB
+	physical_memory = memfd_create("yalnix-pmem", 0);
+	if (physical_memory < 0 || ftruncate(physical_memory, SIM_PMEM_SIZE) < 0) {
+		simFatal("sim: couldn't create physical memory\n");
+	}
+
+	void *reserved = mmap((void *) SIM_MEMORY_BASE, SIM_MEMORY_LIMIT - SIM_MEMORY_BASE, PROT_NONE,
+		MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED_NOREPLACE | MAP_NORESERVE, -1, 0);
+	if (reserved != (void *) SIM_MEMORY_BASE) simFatal("sim: the simulated address range is in use\n");
+
+	// Faults are handled on their own stack, since the kernel stack might be unmapped
+	stack_t signal_stack = { .ss_sp = entry_signal_stack, .ss_size = sizeof(entry_signal_stack) };
+	sigaltstack(&signal_stack, NULL);
+
+	struct sigaction action;
+	memset(&action, 0x00, sizeof(action));
+	action.sa_sigaction = handleFault;
+	action.sa_flags = SA_SIGINFO | SA_ONSTACK;
+	sigaction(SIGSEGV, &action, NULL);
+	sigaction(SIGBUS, &action, NULL);
+
+	createProgramImage();
+	atexit(removeProgramImage);
+
+	static char *default_args[] = { program_name, NULL };
+	if (!cmd_args || !cmd_args[0]) cmd_args = default_args;
+
+	SetKernelData((void *) SIM_KERNEL_DATA, (void *) SIM_KERNEL_DATA_END);
+	enterKernel(runKernelStart, cmd_args);
+}
+
+
+
+
+// The name of a program that Exec will accept
+char* simProgramName() {
+	return program_name;
+}
+
+
+
+
+// Take a trap or an interrupt through the interrupt vector
+void simTrap(int vector) {
+	enterKernel(runTrapHandler, (void *) (long) vector);
+}
+
+
+
+
+/*
+  Make a syscall from the current process. The return value comes from whichever
+  process the kernel goes back to user mode in.
+*/
+
+long simSyscall(int code, long a, long b, long c) {
+	sim_user_context.code = code;
+	sim_user_context.regs[0] = a;
+	sim_user_context.regs[1] = b;
+	sim_user_context.regs[2] = c;
+
+	simTrap(TRAP_KERNEL);
+	return sim_user_context.regs[0];
+}
+
+
+
+
+// Run an arbitrary piece of kernel code as if the current process had trapped
+void simRunInKernel(void (*function) (void *), void *argument) {
+	enterKernel(function, argument);
+}
+
+
+
+
+// Deliver any pending device interrupts, then a clock interrupt
+void simTick() {
+	for (int i=0; i<NUM_TERMINALS; i++) {
+		if (!terminals[i].transmitting) continue;
+
+		terminals[i].transmitting = 0;
+		sim_user_context.code = i;
+		simTrap(TRAP_TTY_TRANSMIT);
+	}
+
+	if (disk_busy) {
+		disk_busy = 0;
+		simTrap(TRAP_DISK);
+	}
+
+	simTrap(TRAP_CLOCK);
+}
+
+
+
+
+// Type a line into a terminal
+void simTtyInput(int tty, char *line) {
+	if (tty < 0 || tty >= NUM_TERMINALS) simFatal("sim: no terminal %d\n", tty);
+
+	int length = strlen(line);
+	if (length > TERMINAL_MAX_LINE - terminals[tty].input_length) {
+		length = TERMINAL_MAX_LINE - terminals[tty].input_length;
+	}
+
+	memcpy(terminals[tty].input + terminals[tty].input_length, line, length);
+	terminals[tty].input_length += length;
+
+	sim_user_context.code = tty;
+	simTrap(TRAP_TTY_RECEIVE);
+}
+
+
+
+
+// Collect whatever's been written to a terminal so far
+int simTtyOutput(int tty, char *buffer, int length) {
+	if (tty < 0 || tty >= NUM_TERMINALS) simFatal("sim: no terminal %d\n", tty);
+
+	if (length > terminals[tty].output_length) length = terminals[tty].output_length;
+	memcpy(buffer, terminals[tty].output, length);
+
+	terminals[tty].output_length -= length;
+	memmove(terminals[tty].output, terminals[tty].output + length, terminals[tty].output_length);
+
+	return length;
+}
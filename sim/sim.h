@@ -0,0 +1,77 @@
+/*
+  File: sim.h
+  Date: 10/19/2026
+  Author: Mitchell Goff
+*/
+
+#ifndef __YALNIX_SIM_H__
+#define __YALNIX_SIM_H__
+
+
+
+/* =============================== *
+
+  			  Includes
+
+ * =============================== */
+
+#include "../include/hardware.h"
+
+
+
+
+
+/* =============================== *
+
+  		   Data Structures
+
+ * =============================== */
+
+/*
+  The simulator stands in for the Yalnix emulator so that the kernel can be built
+  natively and driven from a unit test. It provides physical memory, a software
+  MMU with a TLB, the clock, the terminals and the disk, along with the hardware
+  operations from hardware.h.
+
+  There's no user mode: the test itself plays the part of whatever process is
+  currently running. Every call into the kernel (simSyscall, simTick, etc.) runs on
+  the current process's kernel stack, and returns once the kernel goes back to user
+  mode, which might be in a different process than the one that trapped.
+*/
+
+// How much physical memory the machine has
+#ifndef SIM_PMEM_SIZE
+#define SIM_PMEM_SIZE 0x800000
+#endif
+
+// Where the (pretend) kernel data segment starts and ends in REGION_0
+#define SIM_KERNEL_DATA 0x20000
+#define SIM_KERNEL_DATA_END 0x40000
+
+// The user context the hardware hands to every trap handler
+extern UserContext sim_user_context;
+
+
+
+
+
+/* =============================== *
+
+             Interface
+
+ * =============================== */
+
+void simBoot(char *cmd_args[]);
+char* simProgramName();
+
+void simTrap(int vector);
+long simSyscall(int code, long a, long b, long c);
+void simRunInKernel(void (*function) (void *), void *argument);
+void simTick();
+
+void simTtyInput(int tty, char *line);
+int simTtyOutput(int tty, char *buffer, int length);
+
+
+
+#endif
@@ -0,0 +1,107 @@
+/*
+  File: barrier.c
+  Date: 10/19/2026
+  Author: Mitchell Goff
+*/
+
+
+
+/* =============================== *
+
+  			  Includes
+
+ * =============================== */
+
+#include <stdlib.h>
+
+#include "../process/process.h"
+#include "sync.h"
+
+
+
+
+
+/* =============================== *
+
+  		   Implementation
+
+ * =============================== */
+
+/*
+  A participant that gets killed while it's waiting no longer counts as having
+  arrived, so the rest don't get let through a process short
+*/
+
+static void barrierWaiterDetached(WaitQueue *queue, WaitQueueNode *node) {
+	elementForNode(queue, Barrier, waitqueue)->arrived--;
+}
+
+
+
+
+/*
+  Create a new barrier for $participants processes and add it to the list of resources
+*/
+
+int barrierInitialize(int *barrier_id, int participants) {
+	if (participants <= 0) {
+		TracePrintf(1, "A barrier needs at least one participant\n");
+		return ERROR;
+	}
+
+	Resource *resource = createResourceWithType(RESOURCE_BARRIER);
+	errorIfNull(resource, "Couldn't allocate enough space for a new resource\n");
+
+	resource->location = malloc(sizeof(Barrier));
+	if (!resource->location) {
+		releaseResource(resource);
+		TracePrintf(1, "Couldn't allocate enough space for a new barrier\n");
+		return ERROR;
+	}
+
+	Barrier *barrier = (Barrier *) resource->location;
+	barrierInit(barrier, participants);
+	barrier->waitqueue.waiterDetached = &barrierWaiterDetached;
+
+	*barrier_id = resource->id;
+	return SUCCESS;
+}
+
+
+
+
+/*
+  Wait until every participant has reached the barrier. The last one to arrive
+  starts a new generation and wakes everybody else up in one go, so the barrier
+  is ready to be used again right away. Returns 1 for the last process to arrive
+  and 0 for everyone else.
+*/
+
+int barrierWait(int barrier_id) {
+	Resource *resource = getResourceWithID(barrier_id, RESOURCE_BARRIER);
+	errorIfNull(resource, "It looks like you passed in a non-valid barrier id\n");
+	Barrier *barrier = (Barrier *) resource->location;
+
+	if (++barrier->arrived == barrier->participants) {
+		barrier->arrived = 0;
+		barrier->generation++;
+		signalWaitQueueWithOptions(&barrier->waitqueue, 0);
+		return 1;
+	}
+
+	// Sleep until our generation is over. The barrier might get reclaimed once
+	// we're off its waitqueue, so look it up again every time we wake up.
+	unsigned int generation = barrier->generation;
+	while (barrier->generation == generation) {
+		if (sleepOnWaitQueue(&barrier->waitqueue)) {
+			barrier->arrived--;
+			return ERROR;
+		}
+
+		resource = getResourceWithID(barrier_id, RESOURCE_BARRIER);
+		if (!resource) return 0;
+		barrier = (Barrier *) resource->location;
+	}
+
+	return 0;
+}
@@ -36,34 +36,87 @@ int cvarInitialize(int *cvar_id) {
 	errorIfNull(resource, "Couldn't allocate enough space for a new resource\n");
 
 	resource->location = malloc(sizeof(CondVar));
-	errorIfNull(resource->location, "Couldn't allocate enough space for a new condition variable\n");
+	if (!resource->location) {
+		releaseResource(resource);
+		TracePrintf(1, "Couldn't allocate enough space for a new condition variable\n");
+		return ERROR;
+	}
 
 	cvarInit((CondVar *) resource->location);
 	*cvar_id = resource->id;
+	return SUCCESS;
 }
 
 
 
 
 /*
-  Release the mutex, wait to be signaled, then acquire the mutex again before returning
+  Move a waiter off the condition variable and over to the mutex it's waiting to
+  reacquire. The waiter only wakes up once it owns the mutex. If the mutex was
+  reclaimed in the meantime, we wake it up with an error instead.
 */
 
-int cvarWait(int cvar_id, int mutex_id) {
+static void requeueWaiter(WaitQueueNode *node) {
+	// Once we've been signaled, the timeout no longer applies
+	cancelWaitQueueTimer(node);
+
+	Resource *resource = getResourceWithID((long) node->data, RESOURCE_MUTEX);
+	if (!resource) {
+		node->data = (void *) ERROR;
+		node->prepareToWakeUp(node);
+		return;
+	}
+
+	grantMutex((Mutex *) resource->location, node);
+}
+
+
+
+
+/*
+  Release the mutex and wait to be signaled. Since the kernel can't be interrupted,
+  nobody can signal us between the release and the sleep, and the signaler passes
+  the mutex back to us before we wake up.
+*/
+
+static int waitOnCvar(int cvar_id, int mutex_id, long deadline) {
 	Resource *resource = getResourceWithID(cvar_id, RESOURCE_CVAR);
 	errorIfNull(resource, "It looks like you passed in a non-valid cvar id\n");
 	CondVar *cvar = (CondVar *) resource->location;
 
 	checkForError (mutexRelease(mutex_id));
-	checkForError (sleepOnWaitQueue(&cvar->waitqueue));
-	checkForError (mutexAcquire(mutex_id));
+
+	void *data = (void *) (long) mutex_id;
+	int result = sleepOnWaitQueueWithTimeout(&cvar->waitqueue, &data, deadline);
+	checkForError (result);
+
+	// If we timed out, nobody moved us over to the mutex, so take it back ourselves
+	if (result == TIMEOUT) {
+		checkForError (mutexAcquire(mutex_id));
+		return TIMEOUT;
+	}
+
+	return (data == (void *) ERROR) ? ERROR : SUCCESS;
+}
+
+int cvarWait(int cvar_id, int mutex_id) {
+	return waitOnCvar(cvar_id, mutex_id, NO_DEADLINE);
+}
+
+int cvarWaitWithTimeout(int cvar_id, int mutex_id, int ticks) {
+	if (ticks < 0) {
+		TracePrintf(1, "Hey, we can't go back in time!\n");
+		return ERROR;
+	}
+
+	return waitOnCvar(cvar_id, mutex_id, deadlineAfterTicks(ticks));
 }
 
 
 
 
 /*
-  Signal a single process on the condition variable's waitqueue
+  Move a single process from the condition variable's waitqueue to its mutex
 */
 
 int cvarSignal(int cvar_id) {
@@ -71,14 +124,19 @@ int cvarSignal(int cvar_id) {
 	errorIfNull(resource, "It looks like you passed in a non-valid cvar id\n");
 	CondVar *cvar = (CondVar *) resource->location;
 
-	signalWaitQueue(&cvar->waitqueue);
+	if (!listIsEmpty(&cvar->waitqueue.head)) {
+		requeueWaiter(elementForNode(removeFirstNode(&cvar->waitqueue.head), WaitQueueNode, node));
+	}
+
+	return SUCCESS;
 }
 
 
 
 
 /*
-  Signal all the processes on the condition variable's waitqueue
+  Move every process on the condition variable's waitqueue over to its mutex. At
+  most one of them gets woken up; the rest wait their turn on the mutex.
 */
 
 int cvarBroadcast(int cvar_id) {
@@ -86,5 +144,9 @@ int cvarBroadcast(int cvar_id) {
 	errorIfNull(resource, "It looks like you passed in a non-valid cvar id\n");
 	CondVar *cvar = (CondVar *) resource->location;
 
-	signalWaitQueueWithOptions(&cvar->waitqueue, 0);
+	while (!listIsEmpty(&cvar->waitqueue.head)) {
+		requeueWaiter(elementForNode(removeFirstNode(&cvar->waitqueue.head), WaitQueueNode, node));
+	}
+
+	return SUCCESS;
 }
@@ -0,0 +1,127 @@
+/*
+  File: futex.c
+  Date: 10/19/2026
+  Author: Mitchell Goff
+*/
+
+
+
+/* =============================== *
+
+  			  Includes
+
+ * =============================== */
+
+#include <stdlib.h>
+
+#include "../include/hardware.h"
+#include "../memory/memory.h"
+#include "../process/process.h"
+#include "sync.h"
+
+
+
+
+
+/* =============================== *
+
+  			    Data
+
+ * =============================== */
+
+/*
+  Futexes are the slow path for the user space locks in apps/futex.c. The lock
+  word lives in user memory, so the kernel doesn't keep any per-futex state;
+  sleepers just hang off one of a fixed number of hashed waitqueues, with the
+  futex address stashed in their waitqueue node's data.
+
+  Threads don't share a page table, so the key is the address together with the
+  thread group leader. Two futexes that hash to the same bucket just share a
+  queue; wakeups skip any sleepers whose key doesn't match.
+*/
+
+#define FUTEX_BUCKETS 64
+
+#define futexOwner(process) ((process)->thread_leader ? (process)->thread_leader : (process))
+#define futexBucket(address) (&futex_buckets[((long)(address) >> 2) & (FUTEX_BUCKETS - 1)])
+
+static WaitQueue futex_buckets[FUTEX_BUCKETS];
+
+
+
+
+
+/* =============================== *
+
+  		   Implementation
+
+ * =============================== */
+
+void futexInit() {
+	for (int i=0; i<FUTEX_BUCKETS; i++) {
+		waitQueueInit(&futex_buckets[i]);
+	}
+}
+
+
+
+
+// Make sure a user futex address is aligned and mapped readable in REGION_1
+static int futexAddressIsValid(int *address) {
+	long location = (long) address;
+	if (location < VMEM_1_BASE || location >= VMEM_1_LIMIT || location & (sizeof(int) - 1)) return 0;
+
+	PTE entry = getCurrentProcess()->page_table->entries[indexOfPage(location - VMEM_1_BASE)];
+	return entry.valid && ((entry.perm << 1) & PTE_PERM_READ);
+}
+
+
+
+
+/*
+  Sleep until someone calls futexWake on $address, as long as it still holds
+  $expected. Checking the value and going to sleep happen without any chance of
+  being interrupted, so a wakeup can't slip in between the two.
+*/
+
+int futexWait(int *address, int expected) {
+	if (!futexAddressIsValid(address)) {
+		TracePrintf(1, "It looks like you passed in a non-valid futex address\n");
+		return ERROR;
+	}
+
+	// The lock word changed under us, so let the caller try again
+	if (*(volatile int *) address != expected) return SUCCESS;
+
+	void *data = address;
+	checkForError(sleepOnWaitQueueWithData(futexBucket(address), &data));
+	return SUCCESS;
+}
+
+
+
+
+/*
+  Wake up to $count processes sleeping on $address. Returns how many processes
+  were woken up.
+*/
+
+int futexWake(int *address, int count) {
+	WaitQueue *bucket = futexBucket(address);
+	ProcessDescriptor *owner = futexOwner(getCurrentProcess());
+	LinkedListNode *current = bucket->head.next;
+	int woken = 0;
+
+	while (current != &bucket->head && woken < count) {
+		WaitQueueNode *node = elementForNode(current, WaitQueueNode, node);
+		current = current->next;
+
+		if (node->data != address || futexOwner(node->process) != owner) continue;
+
+		removeNode(&node->node);
+		node->prepareToWakeUp(node);
+		woken++;
+	}
+
+	return woken;
+}
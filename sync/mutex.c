@@ -27,6 +27,17 @@
 
  * =============================== */
 
+/*
+  Pass the mutex on if its holder exits without releasing it
+*/
+
+static void holderExited(LockHold *hold) {
+	handOffMutex(elementForNode(hold, Mutex, hold));
+}
+
+
+
+
 /*
   Create a new mutex and add it to the list of resources
 */
@@ -36,20 +47,72 @@ int mutexInitialize(int *mutex_id) {
 	errorIfNull(resource, "Couldn't allocate enough space for a new resource\n");
 
 	resource->location = malloc(sizeof(Mutex));
-	errorIfNull(resource->location, "Couldn't allocate enough space for a new mutex\n");
+	if (!resource->location) {
+		releaseResource(resource);
+		TracePrintf(1, "Couldn't allocate enough space for a new mutex\n");
+		return ERROR;
+	}
+
+	Mutex *mutex = (Mutex *) resource->location;
+	mutexInit(mutex);
+	mutex->hold.release = &holderExited;
 
-	mutexInit((Mutex *) resource->location);
 	*mutex_id = resource->id;
+	return SUCCESS;
 }
 
 
 
 
 /*
-  Sleep on the mutex's waitqueue until the mutex becomes unlocked
+  Lock the mutex for a waiter, or queue them up behind the current owner. Either
+  way the waiter doesn't have to race anybody for the mutex once it wakes up.
 */
 
-int mutexAcquire(int mutex_id) {
+void grantMutex(Mutex *mutex, WaitQueueNode *node) {
+	if (mutex->locked) {
+		addNodeToWaitQueue(node, &mutex->waitqueue);
+		return;
+	}
+
+	mutex->locked = 1;
+	mutex->current_owner = node->process;
+	takeLockHold(&mutex->hold, node->process);
+	node->prepareToWakeUp(node);
+}
+
+
+
+
+/*
+  Hand the mutex straight to the first process on its waitqueue, or unlock it if
+  nobody is waiting
+*/
+
+void handOffMutex(Mutex *mutex) {
+	dropLockHold(&mutex->hold);
+
+	if (listIsEmpty(&mutex->waitqueue.head)) {
+		mutex->locked = 0;
+		mutex->current_owner = 0;
+		return;
+	}
+
+	WaitQueueNode *node = elementForNode(removeFirstNode(&mutex->waitqueue.head), WaitQueueNode, node);
+	mutex->current_owner = node->process;
+	takeLockHold(&mutex->hold, node->process);
+	node->prepareToWakeUp(node);
+}
+
+
+
+
+/*
+  Sleep on the mutex's waitqueue until the mutex gets handed to us, or until the
+  deadline passes
+*/
+
+static int acquireMutex(int mutex_id, long deadline) {
 	Resource *resource = getResourceWithID(mutex_id, RESOURCE_MUTEX);
 	errorIfNull(resource, "It looks like you passed in a non-valid mutex id\n");
 	Mutex *mutex = (Mutex *) resource->location;
@@ -57,21 +120,38 @@ int mutexAcquire(int mutex_id) {
 	// If we've already acquired this mutex, return immediately
 	if (mutex->current_owner == getCurrentProcess()) return 0;
 
-	// Wait until the mutex becomes available
-	while (mutex->locked) {
-		checkForError(sleepOnWaitQueue(&mutex->waitqueue));
+	// If the mutex is free, just take it
+	if (!mutex->locked) {
+		mutex->locked = 1;
+		mutex->current_owner = getCurrentProcess();
+		takeLockHold(&mutex->hold, getCurrentProcess());
+		return SUCCESS;
 	}
 
-	// Lock the mutex
-	mutex->locked = 1;
-	mutex->current_owner = getCurrentProcess();
+	// Otherwise, the releaser will make us the owner before waking us up
+	void *data = 0;
+	int result = sleepOnWaitQueueWithTimeout(&mutex->waitqueue, &data, deadline);
+	return (result == TIMEOUT || result == ERROR) ? result : SUCCESS;
+}
+
+int mutexAcquire(int mutex_id) {
+	return acquireMutex(mutex_id, NO_DEADLINE);
+}
+
+int mutexAcquireWithTimeout(int mutex_id, int ticks) {
+	if (ticks < 0) {
+		TracePrintf(1, "Hey, we can't go back in time!\n");
+		return ERROR;
+	}
+
+	return acquireMutex(mutex_id, deadlineAfterTicks(ticks));
 }
 
 
 
 
 /*
-  Wake up the next process on the mutex's waitqueue
+  Pass the mutex on to the next process on its waitqueue
 */
 
 int mutexRelease(int mutex_id) {
@@ -79,7 +159,11 @@ int mutexRelease(int mutex_id) {
 	errorIfNull(resource, "It looks like you passed in a non-valid mutex id\n");
 	Mutex *mutex = (Mutex *) resource->location;
 
-	mutex->locked = 0;
-	mutex->current_owner = 0;
-	signalWaitQueue(&mutex->waitqueue);
+	if (mutex->current_owner != getCurrentProcess()) {
+		TracePrintf(1, "Can't release mutex %d since we don't own it\n", mutex_id);
+		return ERROR;
+	}
+
+	handOffMutex(mutex);
+	return SUCCESS;
 }
@@ -0,0 +1,303 @@
+/*
+  File: pipe.c
+  Date: 10/19/2026
+  Author: Mitchell Goff
+*/
+
+
+
+/* =============================== *
+
+  			  Includes
+
+ * =============================== */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "../include/hardware.h"
+#include "../memory/memory.h"
+#include "../process/process.h"
+#include "sync.h"
+
+
+
+
+
+/* =============================== *
+
+  			   Macros
+
+ * =============================== */
+
+/*
+  The pipe's buffer is a ring of PIPE_FRAMES physical page frames. The read and
+  write positions only ever count up, so the amount of buffered data is just the
+  difference between them, and the slot and offset fall out of the position.
+*/
+
+#define PIPE_CAPACITY (PIPE_FRAMES * PAGESIZE)
+
+#define pipeSize(pipe)   ((pipe)->write_position - (pipe)->read_position)
+#define pipeSpace(pipe)  (PIPE_CAPACITY - pipeSize(pipe))
+#define pipeSlot(position)   (((position) >> PAGESHIFT) & (PIPE_FRAMES - 1))
+#define pipeOffset(position) ((position) & PAGEOFFSET)
+
+// The positions are unsigned, so compare everything as a signed long
+#define min(a, b) ((long) (a) < (long) (b) ? (long) (a) : (long) (b))
+
+
+
+
+
+/* =============================== *
+
+  		   Implementation
+
+ * =============================== */
+
+static Pipe* getPipeWithID(int pipe_id) {
+	Resource *resource = getResourceWithID(pipe_id, RESOURCE_PIPE);
+	return resource ? (Pipe *) resource->location : 0;
+}
+
+
+
+// Map one of the pipe's frames into a frame window
+static void* mapPipeFrame(Pipe *pipe, long slot) {
+	long options = PTE_VALID | PTE_PERM_READ | PTE_PERM_WRITE;
+	frame_window_pte(0) = createPTEWithOptions(options, indexOfPage(pipe->frames[slot]));
+	return frame_window(0);
+}
+
+
+
+
+/*
+  Create a new pipe and add it to the list of resources
+*/
+
+int pipeInitialize(int *pipe_id) {
+	Resource *resource = createResourceWithType(RESOURCE_PIPE);
+	errorIfNull(resource, "Couldn't allocate enough space for a new resource\n");
+
+	Pipe *pipe = (Pipe *) malloc(sizeof(Pipe));
+	if (!pipe) {
+		releaseResource(resource);
+		TracePrintf(1, "Couldn't allocate enough space for a new pipe\n");
+		return ERROR;
+	}
+
+	pipeInit(pipe);
+	for (int i=0; i<PIPE_FRAMES; i++) {
+		pipe->frames[i] = allocatePageFrame();
+
+		// If there wasn't enough room, free any page frames we've already allocated
+		if (!pipe->frames[i]) {
+			for (int j=i-1; j>=0; j--) { freePageFrame(pipe->frames[j]); }
+			free(pipe);
+			releaseResource(resource);
+			TracePrintf(1, "Couldn't allocate enough page frames for a new pipe\n");
+			return ERROR;
+		}
+	}
+
+	resource->location = pipe;
+	*pipe_id = resource->id;
+	return SUCCESS;
+}
+
+
+
+
+/*
+  Give the pipe's page frames back. The Pipe struct itself gets freed along with
+  its resource.
+*/
+
+void releasePipeFrames(Pipe *pipe) {
+	freePageFrames(pipe->frames, PIPE_FRAMES);
+}
+
+
+
+
+/*
+  A page that was flipped into the pipe is still shared with the writer, so we
+  have to give the slot its own frame before writing into it again.
+*/
+
+static int makeSlotPrivate(Pipe *pipe, long slot) {
+	void *frame = pipe->frames[slot];
+	if (frc_table[indexOfPage(frame)] == 1) return SUCCESS;
+
+	void *copy = allocatePageFrame();
+	errorIfNull(copy, "Couldn't allocate a page frame for the pipe\n");
+
+	// The slot might still hold unread data, so keep its contents
+	long options = PTE_VALID | PTE_PERM_READ | PTE_PERM_WRITE;
+	frame_window_pte(0) = createPTEWithOptions(options, indexOfPage(frame));
+	frame_window_pte(1) = createPTEWithOptions(options, indexOfPage(copy));
+	memcpy(frame_window(1), frame_window(0), PAGESIZE);
+
+	freePageFrame(frame);
+	pipe->frames[slot] = copy;
+	return SUCCESS;
+}
+
+
+
+
+/*
+  Move a whole, page-aligned user page into an empty slot without copying it. The
+  pipe takes a reference to the writer's frame, and the writer's page becomes
+  copy-on-write, so whichever side writes to it next gets its own copy. Returns
+  0 if the page can't be flipped and has to be copied instead. The buffer must
+  already have been checked with prepareUserRange.
+*/
+
+static int flipUserPage(Pipe *pipe, long slot, void *buffer) {
+	PageTable *table = getCurrentProcess()->page_table;
+	long index = indexOfPage((long) buffer - VMEM_1_BASE);
+	PTE entry = table->entries[index];
+
+	// Pages shared with anybody else (like other threads) have to be copied
+	if (!entry.valid || frc_table[entry.pfn] != 1) return 0;
+
+	freePageFrame(pipe->frames[slot]);
+	frc_table[entry.pfn]++;
+	pipe->frames[slot] = pageAtIndex(entry.pfn);
+
+	long options = PTE_VALID | (entry.perm << 1) | (entry.misc << 4);
+	if (options & PTE_PERM_WRITE) {
+		options = (options & ~PTE_PERM_WRITE) | PTE_COPY_ON_WRITE;
+		table->entries[index] = createPTEWithOptions(options, entry.pfn);
+		flushTLB(buffer);
+		getCurrentProcess()->memory.cow_pending++;
+	}
+
+	return 1;
+}
+
+
+
+
+/*
+  Copy as much of $buffer into the pipe as fits in the current slot. Returns the
+  number of bytes written.
+*/
+
+static int writeSpan(Pipe *pipe, char *buffer, long length) {
+	long slot = pipeSlot(pipe->write_position);
+	long offset = pipeOffset(pipe->write_position);
+	long count = min(length, min(PAGESIZE - offset, pipeSpace(pipe)));
+
+	if (count == PAGESIZE && !((long) buffer & PAGEOFFSET) && flipUserPage(pipe, slot, buffer)) {
+		pipe->write_position += PAGESIZE;
+		return PAGESIZE;
+	}
+
+	checkForError(makeSlotPrivate(pipe, slot));
+	memcpy((char *) mapPipeFrame(pipe, slot) + offset, buffer, count);
+	pipe->write_position += count;
+	return count;
+}
+
+
+
+
+/*
+  Copy as much of the pipe into $buffer as is buffered in the current slot.
+  Returns the number of bytes read.
+*/
+
+static int readSpan(Pipe *pipe, char *buffer, long length) {
+	long slot = pipeSlot(pipe->read_position);
+	long offset = pipeOffset(pipe->read_position);
+	long count = min(length, min(PAGESIZE - offset, pipeSize(pipe)));
+
+	memcpy(buffer, (char *) mapPipeFrame(pipe, slot) + offset, count);
+	pipe->read_position += count;
+	return count;
+}
+
+
+
+
+/*
+  Write all of $buffer into the pipe, sleeping whenever the pipe fills up
+*/
+
+int pipeWrite(int pipe_id, void *buffer, int length) {
+	Pipe *pipe = getPipeWithID(pipe_id);
+	errorIfNull(pipe, "It looks like you passed in a non-valid pipe id\n");
+
+	if (prepareUserRange(getCurrentProcess(), buffer, length, 0) == ERROR) {
+		TracePrintf(1, "Can't write %d bytes from %p to a pipe\n", length, buffer);
+		return ERROR;
+	}
+
+	int written = 0;
+	while (written < length) {
+
+		// Wait for a reader to make some room. The pipe might get reclaimed, or
+		// our address space might change, while we're asleep, so check both
+		// again once we wake up.
+		while (pipeSpace(pipe) == 0) {
+			checkForError(sleepOnWaitQueue(&pipe->write_queue));
+			pipe = getPipeWithID(pipe_id);
+			errorIfNull(pipe, "The pipe was reclaimed while we were writing to it\n");
+			checkForError(prepareUserRange(getCurrentProcess(), (char *) buffer + written, length - written, 0));
+		}
+
+		int count = writeSpan(pipe, (char *) buffer + written, length - written);
+		checkForError(count);
+		written += count;
+
+		signalWaitQueue(&pipe->read_queue);
+	}
+
+	// If there's still room, let the next writer have a go
+	if (pipeSpace(pipe) > 0) signalWaitQueue(&pipe->write_queue);
+	return written;
+}
+
+
+
+
+/*
+  Read up to $length bytes from the pipe, sleeping until there's something to read
+*/
+
+int pipeRead(int pipe_id, void *buffer, int length) {
+	Pipe *pipe = getPipeWithID(pipe_id);
+	errorIfNull(pipe, "It looks like you passed in a non-valid pipe id\n");
+
+	// This also gives the buffer its own copy of any copy-on-write pages
+	if (prepareUserRange(getCurrentProcess(), buffer, length, 1) == ERROR) {
+		TracePrintf(1, "Can't read %d bytes from a pipe into %p\n", length, buffer);
+		return ERROR;
+	}
+
+	if (length == 0) return 0;
+
+	// The buffer might have been unmapped, or shared again by a Fork, while we
+	// were asleep, so check it again once we wake up
+	while (pipeSize(pipe) == 0) {
+		checkForError(sleepOnWaitQueue(&pipe->read_queue));
+		pipe = getPipeWithID(pipe_id);
+		errorIfNull(pipe, "The pipe was reclaimed while we were reading from it\n");
+		checkForError(prepareUserRange(getCurrentProcess(), buffer, length, 1));
+	}
+
+	int bytes_read = 0;
+	while (bytes_read < length && pipeSize(pipe) > 0) {
+		bytes_read += readSpan(pipe, (char *) buffer + bytes_read, length - bytes_read);
+	}
+
+	signalWaitQueue(&pipe->write_queue);
+
+	// If we left some data behind, let the next reader have it
+	if (pipeSize(pipe) > 0) signalWaitQueue(&pipe->read_queue);
+	return bytes_read;
+}
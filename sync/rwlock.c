@@ -0,0 +1,275 @@
+/*
+  File: rwlock.c
+  Date: 10/19/2026
+  Author: Mitchell Goff
+*/
+
+
+
+/* =============================== *
+
+  			  Includes
+
+ * =============================== */
+
+#include <stdlib.h>
+
+#include "../process/process.h"
+#include "sync.h"
+
+
+
+
+
+/* =============================== *
+
+  			   Data
+
+ * =============================== */
+
+/*
+  A read hold records one process holding the lock for reading. It sits on the
+  lock's read_holds through node, and on the reader's held_locks through hold. A
+  reader allocates its hold before it might have to sleep, so whoever grants it
+  the lock can't run out of memory.
+*/
+
+typedef struct ReadHold {
+	ProcessDescriptor *process;
+	RWLock *lock;
+	LinkedListNode node;
+	LockHold hold;
+} ReadHold;
+
+
+
+
+
+/* =============================== *
+
+  		   Implementation
+
+ * =============================== */
+
+/*
+  Give a reader the lock, along with the hold it brought
+*/
+
+static void addReadHold(RWLock *lock, ReadHold *hold) {
+	addLastNode(&hold->node, &lock->read_holds);
+	takeLockHold(&hold->hold, hold->process);
+	lock->readers++;
+}
+
+// Find one of $process's read holds on the lock, if it has any
+static ReadHold* findReadHold(RWLock *lock, ProcessDescriptor *process) {
+	ReadHold *hold;
+	forEachElement(hold, &lock->read_holds, node) {
+		if (hold->process == process) return hold;
+	}
+	return 0;
+}
+
+static void dropReadHold(RWLock *lock, ReadHold *hold) {
+	removeNode(&hold->node);
+	dropLockHold(&hold->hold);
+	free(hold);
+	lock->readers--;
+}
+
+// Make $process the writer, or let the writer go
+static void takeWriteHold(RWLock *lock, ProcessDescriptor *process) {
+	lock->writer = process;
+	takeLockHold(&lock->write_hold, process);
+}
+
+static void dropWriteHold(RWLock *lock) {
+	lock->writer = 0;
+	dropLockHold(&lock->write_hold);
+}
+
+
+
+
+/*
+  Hand the lock to whoever is next in line once it's free. Readers that queued up
+  behind a writer all get the lock together; otherwise the next writer gets it.
+  Queued readers can also join the current readers once no writer is waiting.
+*/
+
+static void grantRWLock(RWLock *lock, int prefer_readers) {
+	if (lock->writer) return;
+
+	if (prefer_readers || listIsEmpty(&lock->write_queue.head)) {
+		while (!listIsEmpty(&lock->read_queue.head)) {
+			WaitQueueNode *node = elementForNode(removeFirstNode(&lock->read_queue.head), WaitQueueNode, node);
+			addReadHold(lock, (ReadHold *) node->data);
+			node->prepareToWakeUp(node);
+		}
+	}
+
+	if (lock->readers == 0 && !listIsEmpty(&lock->write_queue.head)) {
+		WaitQueueNode *node = elementForNode(removeFirstNode(&lock->write_queue.head), WaitQueueNode, node);
+		takeWriteHold(lock, node->process);
+		node->prepareToWakeUp(node);
+	}
+}
+
+
+
+
+/*
+  A reader that gets killed in line never uses the hold it brought. A writer that
+  gets killed in line might have been all that was holding the readers back.
+*/
+
+static void readerDetached(WaitQueue *queue, WaitQueueNode *node) {
+	free(node->data);
+}
+
+static void writerDetached(WaitQueue *queue, WaitQueueNode *node) {
+	grantRWLock(elementForNode(queue, RWLock, write_queue), 0);
+}
+
+
+
+
+/*
+  Pass the lock on if a reader or the writer exits without unlocking it. A reader
+  that held the lock more than once gets here once for each of its holds.
+*/
+
+static void readerExited(LockHold *hold) {
+	ReadHold *read_hold = elementForNode(hold, ReadHold, hold);
+	RWLock *lock = read_hold->lock;
+
+	dropReadHold(lock, read_hold);
+	grantRWLock(lock, 0);
+}
+
+static void writerExited(LockHold *hold) {
+	RWLock *lock = elementForNode(hold, RWLock, write_hold);
+
+	dropWriteHold(lock);
+	grantRWLock(lock, 1);
+}
+
+
+
+
+/*
+  Create a new reader-writer lock and add it to the list of resources
+*/
+
+int rwlockInitialize(int *rwlock_id) {
+	Resource *resource = createResourceWithType(RESOURCE_RWLOCK);
+	errorIfNull(resource, "Couldn't allocate enough space for a new resource\n");
+
+	resource->location = malloc(sizeof(RWLock));
+	if (!resource->location) {
+		releaseResource(resource);
+		TracePrintf(1, "Couldn't allocate enough space for a new reader-writer lock\n");
+		return ERROR;
+	}
+
+	RWLock *lock = (RWLock *) resource->location;
+	rwlockInit(lock);
+	lock->read_queue.waiterDetached = &readerDetached;
+	lock->write_queue.waiterDetached = &writerDetached;
+	lock->write_hold.release = &writerExited;
+
+	*rwlock_id = resource->id;
+	return SUCCESS;
+}
+
+
+
+
+/*
+  Acquire the lock for reading. New readers wait behind any queued writers, so a
+  steady stream of readers can't starve them.
+*/
+
+int rwlockReadLock(int rwlock_id) {
+	Resource *resource = getResourceWithID(rwlock_id, RESOURCE_RWLOCK);
+	errorIfNull(resource, "It looks like you passed in a non-valid reader-writer lock id\n");
+	RWLock *lock = (RWLock *) resource->location;
+
+	ReadHold *hold = (ReadHold *) malloc(sizeof(ReadHold));
+	errorIfNull(hold, "Couldn't allocate enough space for a read hold\n");
+	hold->process = getCurrentProcess();
+	hold->lock = lock;
+	lockHoldInit(&hold->hold);
+	hold->hold.release = &readerExited;
+
+	if (!lock->writer && listIsEmpty(&lock->write_queue.head)) {
+		addReadHold(lock, hold);
+		return SUCCESS;
+	}
+
+	// Whoever releases the lock adds our hold before waking us up
+	void *data = hold;
+	if (sleepOnWaitQueueWithData(&lock->read_queue, &data) == ERROR) {
+		free(hold);
+		return ERROR;
+	}
+	return SUCCESS;
+}
+
+
+
+
+/*
+  Acquire the lock for writing
+*/
+
+int rwlockWriteLock(int rwlock_id) {
+	Resource *resource = getResourceWithID(rwlock_id, RESOURCE_RWLOCK);
+	errorIfNull(resource, "It looks like you passed in a non-valid reader-writer lock id\n");
+	RWLock *lock = (RWLock *) resource->location;
+
+	if (lock->writer == getCurrentProcess()) {
+		TracePrintf(1, "We already hold reader-writer lock %d for writing\n", rwlock_id);
+		return ERROR;
+	}
+
+	if (!lock->writer && lock->readers == 0) {
+		takeWriteHold(lock, getCurrentProcess());
+		return SUCCESS;
+	}
+
+	// Whoever releases the lock makes us the writer before waking us up
+	void *data = 0;
+	checkForError(sleepOnWaitQueueWithData(&lock->write_queue, &data));
+	return SUCCESS;
+}
+
+
+
+
+/*
+  Release the lock, whether we were holding it for reading or for writing. When a
+  writer lets go, every reader that queued up behind it gets woken at once.
+*/
+
+int rwlockUnlock(int rwlock_id) {
+	Resource *resource = getResourceWithID(rwlock_id, RESOURCE_RWLOCK);
+	errorIfNull(resource, "It looks like you passed in a non-valid reader-writer lock id\n");
+	RWLock *lock = (RWLock *) resource->location;
+
+	if (lock->writer == getCurrentProcess()) {
+		dropWriteHold(lock);
+		grantRWLock(lock, 1);
+		return SUCCESS;
+	}
+
+	ReadHold *hold = findReadHold(lock, getCurrentProcess());
+	if (!hold) {
+		TracePrintf(1, "Can't unlock reader-writer lock %d since we don't hold it\n", rwlock_id);
+		return ERROR;
+	}
+
+	dropReadHold(lock, hold);
+	grantRWLock(lock, 0);
+	return SUCCESS;
+}
@@ -0,0 +1,165 @@
+/*
+  File: semaphore.c
+  Date: 10/19/2026
+  Author: Mitchell Goff
+*/
+
+
+
+/* =============================== *
+
+  			  Includes
+
+ * =============================== */
+
+#include <stdlib.h>
+#include <limits.h>
+
+#include "../process/process.h"
+#include "sync.h"
+
+
+
+
+
+/* =============================== *
+
+  		   Implementation
+
+ * =============================== */
+
+/*
+  Hand out units to the processes on the semaphore's waitqueue in FIFO order.
+  Each sleeper keeps the number of units it wants in its node's data, and we
+  stop at the first one we can't satisfy so big requests don't get starved.
+*/
+
+static void grantSemaphore(Semaphore *semaphore) {
+	while (!listIsEmpty(&semaphore->waitqueue.head)) {
+		WaitQueueNode *node = elementForNode(semaphore->waitqueue.head.next, WaitQueueNode, node);
+		long count = (long) node->data;
+		if (count > semaphore->value) return;
+
+		removeNode(&node->node);
+		semaphore->value -= count;
+		node->prepareToWakeUp(node);
+	}
+}
+
+
+
+
+/*
+  A sleeper that gets killed gives up its place in line, which might be all that
+  was holding back the smaller requests behind it
+*/
+
+static void semaphoreWaiterDetached(WaitQueue *queue, WaitQueueNode *node) {
+	grantSemaphore(elementForNode(queue, Semaphore, waitqueue));
+}
+
+
+
+
+/*
+  Create a new semaphore and add it to the list of resources
+*/
+
+int semaphoreInitialize(int *semaphore_id, int value) {
+	if (value < 0) {
+		TracePrintf(1, "A semaphore can't start out with a negative value\n");
+		return ERROR;
+	}
+
+	Resource *resource = createResourceWithType(RESOURCE_SEMAPHORE);
+	errorIfNull(resource, "Couldn't allocate enough space for a new resource\n");
+
+	resource->location = malloc(sizeof(Semaphore));
+	if (!resource->location) {
+		releaseResource(resource);
+		TracePrintf(1, "Couldn't allocate enough space for a new semaphore\n");
+		return ERROR;
+	}
+
+	Semaphore *semaphore = (Semaphore *) resource->location;
+	semaphoreInit(semaphore, value);
+	semaphore->waitqueue.waiterDetached = &semaphoreWaiterDetached;
+
+	*semaphore_id = resource->id;
+	return SUCCESS;
+}
+
+
+
+
+/*
+  Take $count units from the semaphore, sleeping until they become available.
+  The units are already ours by the time we wake up.
+*/
+
+int semaphoreDown(int semaphore_id, int count) {
+	Resource *resource = getResourceWithID(semaphore_id, RESOURCE_SEMAPHORE);
+	errorIfNull(resource, "It looks like you passed in a non-valid semaphore id\n");
+	Semaphore *semaphore = (Semaphore *) resource->location;
+
+	if (count <= 0) {
+		TracePrintf(1, "Can't take %d units from a semaphore\n", count);
+		return ERROR;
+	}
+
+	// Only skip the queue if nobody is already waiting in it
+	if (listIsEmpty(&semaphore->waitqueue.head) && semaphore->value >= count) {
+		semaphore->value -= count;
+		return SUCCESS;
+	}
+
+	void *data = (void *) (long) count;
+	checkForError(sleepOnWaitQueueWithData(&semaphore->waitqueue, &data));
+	return SUCCESS;
+}
+
+
+
+
+/*
+  Take $count units from the semaphore without blocking. Returns 1 if we got
+  them, or 0 if we would have had to wait.
+*/
+
+int semaphoreTryDown(int semaphore_id, int count) {
+	Resource *resource = getResourceWithID(semaphore_id, RESOURCE_SEMAPHORE);
+	errorIfNull(resource, "It looks like you passed in a non-valid semaphore id\n");
+	Semaphore *semaphore = (Semaphore *) resource->location;
+
+	if (count <= 0) {
+		TracePrintf(1, "Can't take %d units from a semaphore\n", count);
+		return ERROR;
+	}
+
+	if (!listIsEmpty(&semaphore->waitqueue.head) || semaphore->value < count) return 0;
+
+	semaphore->value -= count;
+	return 1;
+}
+
+
+
+
+/*
+  Give $count units back to the semaphore and wake up whoever they satisfy
+*/
+
+int semaphoreUp(int semaphore_id, int count) {
+	Resource *resource = getResourceWithID(semaphore_id, RESOURCE_SEMAPHORE);
+	errorIfNull(resource, "It looks like you passed in a non-valid semaphore id\n");
+	Semaphore *semaphore = (Semaphore *) resource->location;
+
+	if (count <= 0 || semaphore->value > INT_MAX - count) {
+		TracePrintf(1, "Can't add %d units to semaphore %d\n", count, semaphore_id);
+		return ERROR;
+	}
+
+	semaphore->value += count;
+	grantSemaphore(semaphore);
+	return SUCCESS;
+}
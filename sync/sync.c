@@ -28,8 +28,31 @@
 
  * =============================== */
 
-LinkedListNode resource_head = linkedListNode(resource_head);
-unsigned long max_resource_id = 0;
+/*
+  Resources live in a table that grows as needed. A resource ID is made up of the
+  index of its slot in the table and the slot's generation number:
+
+    id = (generation << RESOURCE_INDEX_BITS) | slot
+
+  so looking up a resource is a single array access, and an ID that refers to a
+  resource that's since been freed won't match whatever reuses its slot. Slot 0
+  is never used, so 0 is never a valid ID. Free slots are chained together
+  through their next_free field.
+*/
+
+#define RESOURCE_INDEX_BITS 16
+#define RESOURCE_INDEX_MASK ((1 << RESOURCE_INDEX_BITS) - 1)
+#define MAX_RESOURCE_GENERATION (1 << (31 - RESOURCE_INDEX_BITS))
+
+typedef struct ResourceSlot {
+	Resource *resource;
+	unsigned int generation;
+	unsigned int next_free;
+} ResourceSlot;
+
+static ResourceSlot *resource_table = 0;
+static unsigned int resource_table_size = 0;
+static unsigned int free_resource_slot = 0;
 
 
 
@@ -42,34 +65,240 @@ unsigned long max_resource_id = 0;
  * =============================== */
 
 /*
-  Create a new resource and add it the the resource list
+  Double the size of the resource table, and add the new slots to the free list
 */
 
-Resource* getResourceWithID(int id, enum ResourceType type) {
-	Resource *current;
-	forEachElement(current, &resource_head, node) {
-		if (current->id == id) {
-			return current->type == type ? current : 0;
-		}
+static int growResourceTable() {
+	unsigned int new_size = resource_table_size ? resource_table_size * 2 : 16;
+	if (new_size > RESOURCE_INDEX_MASK + 1) return ERROR;
+
+	ResourceSlot *table = (ResourceSlot *) realloc(resource_table, new_size * sizeof(ResourceSlot));
+	if (!table) return ERROR;
+
+	// Chain the new slots onto the free list, skipping slot 0
+	for (unsigned int i=new_size-1; i>=resource_table_size && i>0; i--) {
+		table[i].resource = 0;
+		table[i].generation = 0;
+		table[i].next_free = free_resource_slot;
+		free_resource_slot = i;
 	}
 
-	return 0;
+	resource_table = table;
+	resource_table_size = new_size;
+	return SUCCESS;
 }
 
 
 
 
 /*
-  Sleep on the mutex's waitqueue until the mutex becomes unlocked
+  Look up a resource by its ID in constant time
+*/
+
+static Resource* lookupResource(int id) {
+	unsigned int slot = id & RESOURCE_INDEX_MASK;
+	if (id <= 0 || slot >= resource_table_size) return 0;
+
+	Resource *resource = resource_table[slot].resource;
+	return (resource && resource->id == (unsigned int) id) ? resource : 0;
+}
+
+Resource* getResourceWithID(int id, enum ResourceType type) {
+	Resource *resource = lookupResource(id);
+	return (resource && resource->type == type) ? resource : 0;
+}
+
+
+
+
+/*
+  Create a new resource and give it a slot in the resource table
 */
 
 Resource* createResourceWithType(enum ResourceType type) {
+	if (!free_resource_slot && growResourceTable() == ERROR) return 0;
+
 	Resource *resource = (Resource *) malloc(sizeof(Resource));
 	if (!resource) return 0;
 
-	resource->id = ++max_resource_id;
+	// Take the first free slot
+	unsigned int slot = free_resource_slot;
+	free_resource_slot = resource_table[slot].next_free;
+	resource_table[slot].resource = resource;
+
+	resource->id = (resource_table[slot].generation << RESOURCE_INDEX_BITS) | slot;
 	resource->type = type;
-	addLastNode(&resource->node, &resource_head);
+	resource->location = 0;
+
+	// Resources created by a thread belong to its whole thread group
+	ProcessDescriptor *process = getCurrentProcess();
+	resource->owner = process->thread_leader ? process->thread_leader : process;
+	addLastNode(&resource->owner_node, &resource->owner->resources);
 
 	return resource;
 }
+
+
+
+
+/*
+  Give a resource's slot back to the table and free the resource. The slot's
+  generation gets bumped, so the old ID stops working right away.
+*/
+
+void releaseResource(Resource *resource) {
+	unsigned int slot = resource->id & RESOURCE_INDEX_MASK;
+	removeNode(&resource->owner_node);
+
+	resource_table[slot].resource = 0;
+	resource_table[slot].generation = (resource_table[slot].generation + 1) % MAX_RESOURCE_GENERATION;
+	resource_table[slot].next_free = free_resource_slot;
+	free_resource_slot = slot;
+
+	free(resource);
+}
+
+
+
+
+/*
+  Check whether a resource is still in use by anyone other than $process. We
+  never free a resource that somebody is sleeping on.
+*/
+
+static int resourceIsBusy(Resource *resource, ProcessDescriptor *process) {
+	switch (resource->type) {
+		case RESOURCE_MUTEX: {
+			Mutex *mutex = (Mutex *) resource->location;
+			if (mutex->locked && mutex->current_owner != process) return 1;
+			return !listIsEmpty(&mutex->waitqueue.head);
+		}
+
+		case RESOURCE_CVAR:
+			return !listIsEmpty(&((CondVar *) resource->location)->waitqueue.head);
+
+		case RESOURCE_SEMAPHORE:
+			return !listIsEmpty(&((Semaphore *) resource->location)->waitqueue.head);
+
+		case RESOURCE_RWLOCK: {
+			RWLock *lock = (RWLock *) resource->location;
+			if ((lock->writer && lock->writer != process) || lock->readers > 0) return 1;
+			return !listIsEmpty(&lock->read_queue.head) || !listIsEmpty(&lock->write_queue.head);
+		}
+
+		case RESOURCE_BARRIER: {
+			Barrier *barrier = (Barrier *) resource->location;
+			return barrier->arrived > 0 || !listIsEmpty(&barrier->waitqueue.head);
+		}
+
+		case RESOURCE_PIPE: {
+			Pipe *pipe = (Pipe *) resource->location;
+			return !listIsEmpty(&pipe->read_queue.head) || !listIsEmpty(&pipe->write_queue.head);
+		}
+
+		default:
+			return 0;
+	}
+}
+
+
+
+
+/*
+  Free a resource along with whatever it points to
+*/
+
+static void destroyResource(Resource *resource) {
+	if (resource->type == RESOURCE_PIPE) releasePipeFrames((Pipe *) resource->location);
+
+	// We might be reclaiming a lock we still hold ourselves
+	if (resource->type == RESOURCE_MUTEX) dropLockHold(&((Mutex *) resource->location)->hold);
+	if (resource->type == RESOURCE_RWLOCK) dropLockHold(&((RWLock *) resource->location)->write_hold);
+
+	free(resource->location);
+	releaseResource(resource);
+}
+
+
+
+
+/*
+  Destroy the resource with the given ID on behalf of the Reclaim syscall. Only
+  the thread group that created it can, unless its owner has exited.
+*/
+
+int reclaimResource(int id) {
+	Resource *resource = lookupResource(id);
+	errorIfNull(resource, "It looks like you passed in a non-valid resource id\n");
+
+	ProcessDescriptor *process = getCurrentProcess();
+	ProcessDescriptor *group = process->thread_leader ? process->thread_leader : process;
+	if (resource->owner && resource->owner != group) {
+		TracePrintf(1, "Can't reclaim resource %d since we don't own it\n", id);
+		return ERROR;
+	}
+
+	if (resourceIsBusy(resource, getCurrentProcess())) {
+		TracePrintf(1, "Can't reclaim resource %d while it's still in use\n", id);
+		return ERROR;
+	}
+
+	destroyResource(resource);
+	return SUCCESS;
+}
+
+
+
+
+/*
+  Clean up all the resources owned by an exiting process. Anything that other
+  processes are still using gets disowned instead, so nobody wakes up on freed
+  memory; it can still be reclaimed later on.
+*/
+
+void releaseOwnedResources(ProcessDescriptor *process) {
+	while (!listIsEmpty(&process->resources)) {
+		Resource *resource = elementForNode(process->resources.next, Resource, owner_node);
+
+		if (resourceIsBusy(resource, process)) {
+			removeNode(&resource->owner_node);
+			linkedListNodeInit(&resource->owner_node);
+			resource->owner = 0;
+		}
+		else destroyResource(resource);
+	}
+}
+
+
+
+
+/*
+  Let go of every lock an exiting process is still holding, whoever created it,
+  so the processes waiting on them don't sleep forever. Each release takes the
+  hold off our list, and may put it on the next holder's.
+*/
+
+void releaseHeldLocks(ProcessDescriptor *process) {
+	while (!listIsEmpty(&process->held_locks)) {
+		LockHold *hold = elementForNode(process->held_locks.next, LockHold, node);
+		hold->release(hold);
+	}
+}
+
+
+
+
+/*
+  Add a reference to $references for every page frame held by a pipe, whoever
+  owns it. This is for the memory checker (see memory/check.c).
+*/
+
+void countPipeFrames(unsigned short *references) {
+	for (unsigned int slot=1; slot<resource_table_size; slot++) {
+		Resource *resource = resource_table[slot].resource;
+		if (!resource || resource->type != RESOURCE_PIPE || !resource->location) continue;
+
+		Pipe *pipe = (Pipe *) resource->location;
+		for (int i=0; i<PIPE_FRAMES; i++) references[indexOfPage(pipe->frames[i])]++;
+	}
+}
@@ -17,6 +17,7 @@
 
 #include "../core/list.h"
 #include "../process/process.h"
+#include "waitqueue.h"
 
 
 
@@ -29,21 +30,24 @@
  * =============================== */
 
 struct Resource;
-struct WaitQueueNode;
-struct WaitQueue;
+struct LockHold;
 struct Mutex;
 struct CondVar;
+struct Semaphore;
+struct Pipe;
+struct RWLock;
+struct Barrier;
 
 typedef struct Resource Resource;
-typedef struct WaitQueueNode WaitQueueNode;
-typedef struct WaitQueue WaitQueue;
+typedef struct LockHold LockHold;
 typedef struct Mutex Mutex;
 typedef struct CondVar CondVar;
+typedef struct Semaphore Semaphore;
+typedef struct Pipe Pipe;
+typedef struct RWLock RWLock;
+typedef struct Barrier Barrier;
 
 typedef volatile int Spinlock;
-typedef int (*WaitQueueHandler) (WaitQueueNode*);
-
-extern LinkedListNode resource_head;
 
 
 
@@ -56,57 +60,51 @@ enum ResourceType {
     RESOURCE_MUTEX,
     RESOURCE_CVAR,
     RESOURCE_PIPE,
+    RESOURCE_SEMAPHORE,
+    RESOURCE_RWLOCK,
+    RESOURCE_BARRIER,
 };
 
 
 
 
 /*
-  The Resource struct allows us to keep references to all synchronization resources
-  in a single linked list
+  The Resource struct lets us refer to any synchronization resource by its ID.
+  See sync.c for how the IDs map onto the resource table.
+
+  owner:      The process (or thread group leader) that created the resource. Its
+              resources get cleaned up automatically when it exits
+  owner_node: A linked list node for the owner's resource list to hook onto
 */
 
 struct Resource {
     unsigned int id;
     enum ResourceType type;
     void *location;
-    LinkedListNode node;
+
+    ProcessDescriptor *owner;
+    LinkedListNode owner_node;
 };
 
 
 
 
 /*
-  The WaitQueueNode struct allows processes to add themselves to a
-  waitqueue and get notified when some event becomes true.
-
-  is_exclusive:   Determines whether the process is exclusive or not
-  wakeup_handler: The function to run when the process gets off the waitqueue
-  process:      The process to add to the waitqueue
-  node:       A linked list node for the waitqueue to hook onto
+  A LockHold records a process holding a mutex or a reader-writer lock, and sits
+  on that process's held_locks list while it does. When the process exits we only
+  have to walk its own holds, calling release on each one to pass the lock on.
 */
 
-struct WaitQueueNode {
-    unsigned int is_exclusive;
-    WaitQueueHandler prepareToWakeUp;
-    ProcessDescriptor *process;
+typedef void (*LockHoldRelease) (LockHold*);
+
+struct LockHold {
     LinkedListNode node;
+    LockHoldRelease release;
 };
 
 
 
 
-/*
-  The WaitQueue struct keeps track of a single waitqueue and allows us to
-  iterate over all the processes, or to dequeue just the next process.
-*/
-
-struct WaitQueue {
-    LinkedListNode head;
-};
-
-
-
 /*
   The Mutex struct provides a basic lock primative that processes can use for
   synchronization.
@@ -115,6 +113,7 @@ struct WaitQueue {
 struct Mutex {
 	volatile int locked;
   ProcessDescriptor *current_owner;
+	LockHold hold;
 	WaitQueue waitqueue;
 };
 
@@ -133,43 +132,106 @@ struct CondVar {
 
 
 
+/*
+  The Semaphore struct provides a counting semaphore. Processes sleeping on the
+  waitqueue get their units handed to them in the order they went to sleep.
+*/
+
+struct Semaphore {
+    int value;
+    WaitQueue waitqueue;
+};
+
+
+
+
+/*
+  The RWLock struct provides a reader-writer lock. Any number of readers can hold
+  the lock at once, or a single writer. Readers and writers sleep on separate
+  waitqueues so a writer's release can wake up every waiting reader together.
+  Every read hold is kept on read_holds, so we know which processes to expect
+  an unlock from (see rwlock.c). The writer holds the lock through write_hold.
+*/
+
+struct RWLock {
+    int readers;
+    ProcessDescriptor *writer;
+    LockHold write_hold;
+    LinkedListNode read_holds;
+    WaitQueue read_queue;
+    WaitQueue write_queue;
+};
 
-/* =============================== *
 
-  		      Macros
 
- * =============================== */
 
 /*
-  Macros and functions to create an initialize waitqueues
+  The Barrier struct lets a fixed number of processes wait for each other. Each
+  time the last participant arrives, the generation gets bumped and everyone on
+  the waitqueue is woken up together.
 */
 
-// Statically initialize a new waitqueue
-#define waitQueue(name) { linkedListNode((name).head) }
+struct Barrier {
+    int participants;
+    int arrived;
+    unsigned int generation;
+    WaitQueue waitqueue;
+};
+
 
-// Dynamically initialize a new waitqueue
-#define waitQueueInit(name) \
-    linkedListNodeInit(&(name)->head)
 
-// Create a new waitqueue variable
-#define newWaitQueue(name) \
-    WaitQueue name = waitQueue(name)
 
+/*
+  The Pipe struct keeps track of a pipe's ring buffer (see pipe.c). Readers and
+  writers sleep on separate waitqueues, so a write only ever wakes up readers
+  and vice versa.
+*/
+
+#ifndef PIPE_FRAMES
+#define PIPE_FRAMES 4 // must be a power of 2
+#endif
+
+struct Pipe {
+    void *frames[PIPE_FRAMES];
+    unsigned long read_position;
+    unsigned long write_position;
+
+    WaitQueue read_queue;
+    WaitQueue write_queue;
+};
+
+
+
+
+
+/* =============================== *
+
+  		      Macros
+
+ * =============================== */
+
+/*
+  Macros to set up lock holds, and to move them on and off a holder's list
+*/
 
+// Statically initialize a lock hold. Its release function gets filled in later.
+#define lockHold(name) { linkedListNode((name).node), 0 }
 
-// Statically initialize a new waitqueue node
-#define waitQueueNode(name) { 1, &wakeUpProcess, getCurrentProcess(), linkedListNode((name).node) }
+// Dynamically initialize a lock hold
+#define lockHoldInit(name) \
+    linkedListNodeInit(&(name)->node); \
+    (name)->release = 0
 
-// Dynamically initialize a new waitqueue node
-#define waitQueueNodeInit(name) \
-    (name)->is_exclusive = 0; \
-    (name)->prepareToWakeUp = &wakeUpProcess; \
-    (name)->process = getCurrentProcess(); \
-    linkedListNodeInit(&(name)->node)
+// Record that $process now holds the lock behind $hold
+#define takeLockHold(hold, process) \
+    addLastNode(&(hold)->node, &(process)->held_locks)
 
-// Create a new waitqueue node variable
-#define newWaitQueueNode(name) \
-    WaitQueueNode name = waitQueueNode(name)
+// Take $hold off its holder's list. This is fine on a hold nobody has.
+#define dropLockHold(hold) \
+    do { \
+        removeNode(&(hold)->node); \
+        linkedListNodeInit(&(hold)->node); \
+    } while (0)
 
 
 
@@ -179,12 +241,13 @@ struct CondVar {
 */
 
 // Statically initialize a mutex
-#define mutex(name) { 0, 0, waitQueue((name).waitqueue) }
+#define mutex(name) { 0, 0, lockHold((name).hold), waitQueue((name).waitqueue) }
 
 // Dynamically initialize a mutex
 #define mutexInit(name) \
 	(name)->locked = 0; \
   (name)->current_owner = 0; \
+	lockHoldInit(&(name)->hold); \
 	waitQueueInit(&(name)->waitqueue)
 
 // Create a new mutex variable
@@ -212,6 +275,84 @@ struct CondVar {
 
 
 
+/*
+  Macros and functions to create an initialize semaphores
+*/
+
+// Statically initialize a semaphore
+#define semaphore(name, count) { (count), waitQueue((name).waitqueue) }
+
+// Dynamically initialize a semaphore
+#define semaphoreInit(name, count) \
+    (name)->value = (count); \
+    waitQueueInit(&(name)->waitqueue)
+
+// Create a new semaphore variable
+#define newSemaphore(name, count) \
+    Semaphore name = semaphore(name, count)
+
+
+
+
+/*
+  Macros and functions to create an initialize reader-writer locks
+*/
+
+// Statically initialize a reader-writer lock
+#define rwlock(name) { 0, 0, lockHold((name).write_hold), linkedListNode((name).read_holds), \
+    waitQueue((name).read_queue), waitQueue((name).write_queue) }
+
+// Dynamically initialize a reader-writer lock
+#define rwlockInit(name) \
+    (name)->readers = 0; \
+    (name)->writer = 0; \
+    lockHoldInit(&(name)->write_hold); \
+    linkedListNodeInit(&(name)->read_holds); \
+    waitQueueInit(&(name)->read_queue); \
+    waitQueueInit(&(name)->write_queue)
+
+// Create a new reader-writer lock variable
+#define newRWLock(name) \
+    RWLock name = rwlock(name)
+
+
+
+
+/*
+  Macros and functions to create an initialize barriers
+*/
+
+// Statically initialize a barrier
+#define barrier(name, count) { (count), 0, 0, waitQueue((name).waitqueue) }
+
+// Dynamically initialize a barrier
+#define barrierInit(name, count) \
+    (name)->participants = (count); \
+    (name)->arrived = 0; \
+    (name)->generation = 0; \
+    waitQueueInit(&(name)->waitqueue)
+
+// Create a new barrier variable
+#define newBarrier(name, count) \
+    Barrier name = barrier(name, count)
+
+
+
+
+/*
+  Macros and functions to initialize pipes. The page frames get allocated
+  separately, in pipeInitialize.
+*/
+
+#define pipeInit(name) \
+    (name)->read_position = 0; \
+    (name)->write_position = 0; \
+    waitQueueInit(&(name)->read_queue); \
+    waitQueueInit(&(name)->write_queue)
+
+
+
+
 
 /* =============================== *
 
@@ -222,30 +363,57 @@ struct CondVar {
 void aquireSpinlock(Spinlock *lock);
 void releaseSpinlock(Spinlock *lock);
 
-void addToWaitQueue(WaitQueueNode *node, WaitQueue *head);
-int sleepOnWaitQueue(WaitQueue *head);
-int sleepOnWaitQueueWithOptions(WaitQueue *head, int exclusive);
-void signalWaitQueue(WaitQueue *head);
-void signalWaitQueueWithOptions(WaitQueue *head, int exclusive);
-
-void putProcessToSleep();
-int wakeUpProcess(WaitQueueNode *node);
-
 
 Resource* createResourceWithType(enum ResourceType type);
 Resource* getResourceWithID(int id, enum ResourceType type);
+void releaseResource(Resource *resource);
+int reclaimResource(int id);
+void releaseOwnedResources(ProcessDescriptor *process);
+void releaseHeldLocks(ProcessDescriptor *process);
+void countPipeFrames(unsigned short *references);
 
 
 int mutexInitialize(int *mutex_id);
 int mutexAcquire(int mutex_id);
+int mutexAcquireWithTimeout(int mutex_id, int ticks);
 int mutexRelease(int mutex_id);
+void grantMutex(Mutex *mutex, WaitQueueNode *node);
+void handOffMutex(Mutex *mutex);
 
 
 int cvarInitialize(int *cvar_id);
 int cvarWait(int cvar_id, int mutex_id);
+int cvarWaitWithTimeout(int cvar_id, int mutex_id, int ticks);
 int cvarSignal(int cvar_id);
 int cvarBroadcast(int cvar_id);
 
 
+int semaphoreInitialize(int *semaphore_id, int value);
+int semaphoreDown(int semaphore_id, int count);
+int semaphoreTryDown(int semaphore_id, int count);
+int semaphoreUp(int semaphore_id, int count);
+
+
+int rwlockInitialize(int *rwlock_id);
+int rwlockReadLock(int rwlock_id);
+int rwlockWriteLock(int rwlock_id);
+int rwlockUnlock(int rwlock_id);
+
+
+int barrierInitialize(int *barrier_id, int participants);
+int barrierWait(int barrier_id);
+
+
+int pipeInitialize(int *pipe_id);
+int pipeRead(int pipe_id, void *buffer, int length);
+int pipeWrite(int pipe_id, void *buffer, int length);
+void releasePipeFrames(Pipe *pipe);
+
+
+void futexInit();
+int futexWait(int *address, int expected);
+int futexWake(int *address, int count);
+
+
 
 #endif
@@ -0,0 +1,157 @@
+/* Tests for pipe.c */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <assert.h>
+#include <string.h>
+
+#include "../../include/yalnix.h"
+#include "../sync.h"
+#include "../../process/process.h"
+#include "../../sim/sim.h"
+
+#define PIPE_CAPACITY (PIPE_FRAMES * PAGESIZE)
+#define HEAP_PAGES (2 * PIPE_FRAMES + 4)
+
+int pipe_id;
+char *heap;
+
+// Everything in the heap is at least a page in, so the tests can use page-aligned buffers
+#define source (heap)
+#define destination (heap + PIPE_CAPACITY + PAGESIZE)
+#define spare_page (heap + (HEAP_PAGES - 1) * PAGESIZE)
+
+
+long writePipe(void *buffer, long length) {
+	return simSyscall(YALNIX_PIPE_WRITE, pipe_id, (long) buffer, length);
+}
+
+long readPipe(void *buffer, long length) {
+	return simSyscall(YALNIX_PIPE_READ, pipe_id, (long) buffer, length);
+}
+
+PTE* pteFor(void *address) {
+	long index = indexOfPage(DOWN_TO_PAGE(address) - VMEM_1_BASE);
+	return &getCurrentProcess()->page_table->entries[index];
+}
+
+long optionsFor(void *address) {
+	PTE *entry = pteFor(address);
+	return (entry->perm << 1) | (entry->misc << 4);
+}
+
+void fillWithPattern(char *buffer, long length, int seed) {
+	for (long i=0; i<length; i++) buffer[i] = (char) (i * 7 + seed);
+}
+
+
+// Write and read back enough that the data wraps around the end of the ring
+void testRingWrap(Pipe *pipe) {
+	fillWithPattern(source, PIPE_CAPACITY, 1);
+	assert(writePipe(source + 1, PIPE_CAPACITY - 100) == PIPE_CAPACITY - 100);
+	assert(readPipe(destination, PIPE_CAPACITY) == PIPE_CAPACITY - 100);
+	assert(memcmp(destination, source + 1, PIPE_CAPACITY - 100) == 0);
+
+	assert(writePipe(source + 3, 300) == 300);
+	assert(pipe->write_position % PIPE_CAPACITY < pipe->read_position % PIPE_CAPACITY);
+	assert(readPipe(destination, 300) == 300);
+	assert(memcmp(destination, source + 3, 300) == 0);
+}
+
+
+// A whole, page-aligned page gets flipped into the ring, and the first copying
+// write into its slot afterwards gives the slot its own frame again
+void testPageFlip(Pipe *pipe) {
+	// Line the ring up with the start of a slot
+	long offset = pipe->write_position % PAGESIZE;
+	if (offset) {
+		assert(writePipe(source + 1, PAGESIZE - offset) == PAGESIZE - offset);
+		assert(readPipe(destination, PAGESIZE) == PAGESIZE - offset);
+	}
+
+	fillWithPattern(spare_page, PAGESIZE, 2);
+	long pfn = pteFor(spare_page)->pfn;
+	long slot = (pipe->write_position / PAGESIZE) % PIPE_FRAMES;
+
+	assert(writePipe(spare_page, PAGESIZE) == PAGESIZE);
+	assert(pipe->frames[slot] == pageAtIndex(pfn));
+	assert(frc_table[pfn] == 2);
+	assert(optionsFor(spare_page) & PTE_COPY_ON_WRITE);
+	assert(!(optionsFor(spare_page) & PTE_PERM_WRITE));
+
+	assert(readPipe(destination, PAGESIZE) == PAGESIZE);
+	assert(memcmp(destination, spare_page, PAGESIZE) == 0);
+
+	// Go around the ring, so the next write lands in the flipped slot
+	for (int i=1; i<PIPE_FRAMES; i++) {
+		assert(writePipe(source + 1, PAGESIZE) == PAGESIZE);
+		assert(readPipe(destination, PAGESIZE) == PAGESIZE);
+	}
+
+	assert(writePipe(source + 5, 64) == 64);
+	assert(pipe->frames[slot] != pageAtIndex(pfn));
+	assert(frc_table[pfn] == 1);
+	assert(readPipe(destination, 64) == 64);
+	assert(memcmp(destination, source + 5, 64) == 0);
+
+	// The writer's page never changed underneath it
+	char expected[PAGESIZE];
+	fillWithPattern(expected, PAGESIZE, 2);
+	assert(memcmp(spare_page, expected, PAGESIZE) == 0);
+}
+
+
+// Reading into a page that's copy-on-write after a Fork gives us our own copy first
+void testReadIntoCopyOnWrite() {
+	fillWithPattern(destination, PAGESIZE, 3);
+	long pfn = pteFor(destination)->pfn;
+
+	PID pid = simSyscall(YALNIX_FORK, 0, 0, 0);
+	assert(getProcessWithPID(pid));
+	assert(optionsFor(destination) & PTE_COPY_ON_WRITE);
+
+	assert(writePipe(source, 100) == 100);
+	assert(readPipe(destination, 100) == 100);
+	assert(memcmp(destination, source, 100) == 0);
+
+	assert(pteFor(destination)->pfn != pfn);
+	assert(optionsFor(destination) & PTE_PERM_WRITE);
+	assert(!(optionsFor(destination) & PTE_COPY_ON_WRITE));
+}
+
+
+// Buffers that aren't ours, or that we can't write to, get turned away
+void testBadBuffers(Pipe *pipe) {
+	assert(writePipe((void *) KERNEL_STACK_BASE, 16) == ERROR);
+	assert(writePipe(heap + HEAP_PAGES * PAGESIZE, 16) == ERROR);
+	assert(writePipe(source, -1) == ERROR);
+	assert(pipe->write_position == pipe->read_position);
+
+	assert(writePipe(source, 16) == 16);
+	assert(readPipe((void *) KERNEL_STACK_BASE, 16) == ERROR);
+	assert(readPipe(heap + HEAP_PAGES * PAGESIZE - 8, 16) == ERROR);
+	assert(readPipe((void *) VMEM_1_BASE, 16) == ERROR);
+	assert(readPipe(destination, 16) == 16);
+}
+
+
+
+int main() {
+	simBoot(NULL);
+
+	// Grow the heap, so we have somewhere to read and write from
+	ProcessInfo *info = (ProcessInfo *) KERNEL_STACK_BASE;
+	heap = (char *) UP_TO_PAGE(info->current_brk) + PAGESIZE;
+	assert(simSyscall(YALNIX_BRK, (long) (heap + HEAP_PAGES * PAGESIZE), 0, 0) == SUCCESS);
+
+	assert(simSyscall(YALNIX_PIPE_INIT, (long) &pipe_id, 0, 0) == SUCCESS);
+	Pipe *pipe = (Pipe *) getResourceWithID(pipe_id, RESOURCE_PIPE)->location;
+
+	testRingWrap(pipe);
+	testPageFlip(pipe);
+	testReadIntoCopyOnWrite();
+	testBadBuffers(pipe);
+
+	printf("All tests passed!\n");
+	return 0;
+}
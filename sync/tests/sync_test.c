@@ -0,0 +1,296 @@
+/* Tests for the sync resources, and what happens to locks when their holders exit */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <assert.h>
+#include <string.h>
+
+#include "../../include/yalnix.h"
+#include "../../include/custom.h"
+#include "../sync.h"
+#include "../../process/process.h"
+#include "../../sim/sim.h"
+
+
+int mutex_id;
+int semaphore_id;
+int rwlock_id;
+int barrier_id;
+int status;
+
+
+// Let the clock tick until $process is the one running, which shouldn't take long
+void runAs(ProcessDescriptor *process) {
+	for (int ticks=0; getCurrentProcess() != process; ticks++) {
+		assert(ticks < 100);
+		simTick();
+	}
+}
+
+// Fork a child of the current process, which stays put
+ProcessDescriptor* forkChild() {
+	ProcessDescriptor *parent = getCurrentProcess();
+	long pid = simSyscall(YALNIX_FORK, 0, 0, 0);
+	assert(getCurrentProcess() == parent);
+	return getProcessWithPID(pid);
+}
+
+// Give the current process a fresh page at the top of its heap, which nobody else shares
+int* growHeap() {
+	char *page = (char *) UP_TO_PAGE(((ProcessInfo *) KERNEL_STACK_BASE)->current_brk);
+	assert(simSyscall(YALNIX_BRK, (long) (page + PAGESIZE), 0, 0) == SUCCESS);
+	return (int *) page;
+}
+
+// How many locks $process is holding
+int countHeldLocks(ProcessDescriptor *process) {
+	int count = 0;
+	forEachNode(node, &process->held_locks) count++;
+	return count;
+}
+
+// These run inside the kernel, on behalf of the driver
+void killOther(void *process) {
+	killProcess((ProcessDescriptor *) process, 0);
+}
+
+
+// A mutex whose holder exits goes to the next waiter, and only its creator can reclaim it
+void testMutexHolderExits(ProcessDescriptor *driver) {
+	ProcessDescriptor *child = forkChild();
+
+	runAs(child);
+	assert(simSyscall(YALNIX_LOCK_INIT, (long) &mutex_id, 0, 0) == SUCCESS);
+	assert(simSyscall(YALNIX_LOCK_ACQUIRE, mutex_id, 0, 0) == SUCCESS);
+	Mutex *mutex = (Mutex *) getResourceWithID(mutex_id, RESOURCE_MUTEX)->location;
+
+	runAs(driver);
+	assert(simSyscall(YALNIX_RECLAIM, mutex_id, 0, 0) == ERROR);
+
+	// Block on the mutex, so we come back out in the child
+	simSyscall(YALNIX_LOCK_ACQUIRE, mutex_id, 0, 0);
+	assert(getCurrentProcess() == child);
+	simSyscall(YALNIX_EXIT, 0, 0, 0);
+
+	// The child's exit hands us the mutex, and leaves it unowned so we can reclaim it
+	runAs(driver);
+	assert(sim_user_context.regs[0] == SUCCESS);
+	assert(mutex->current_owner == driver);
+	assert(simSyscall(YALNIX_WAIT, (long) &status, 0, 0) == 0);
+	assert(simSyscall(YALNIX_RECLAIM, mutex_id, 0, 0) == SUCCESS);
+}
+
+
+// A semaphore waiter that gets killed lets the smaller requests behind it through
+void testSemaphoreWaiterKilled(ProcessDescriptor *driver) {
+	assert(simSyscall(YALNIX_SEM_INIT, (long) &semaphore_id, 1, 0) == SUCCESS);
+	Semaphore *semaphore = (Semaphore *) getResourceWithID(semaphore_id, RESOURCE_SEMAPHORE)->location;
+	ProcessDescriptor *big = forkChild();
+	ProcessDescriptor *small = forkChild();
+
+	runAs(big);
+	simSyscall(YALNIX_CUSTOM_2, CUSTOM_SEM_DOWN_N, semaphore_id, 3);
+	runAs(small);
+	simSyscall(YALNIX_SEM_DOWN, semaphore_id, 0, 0);
+	assert(small->state == PROCESS_WAITING);
+
+	runAs(driver);
+	simRunInKernel(killOther, big);
+	assert(small->state == PROCESS_RUNNING);
+	assert(semaphore->value == 0);
+
+	runAs(small);
+	assert(sim_user_context.regs[0] == SUCCESS);
+	simSyscall(YALNIX_EXIT, 0, 0, 0);
+
+	runAs(driver);
+	assert(simSyscall(YALNIX_WAIT, (long) &status, 0, 0) == 0);
+	assert(simSyscall(YALNIX_WAIT, (long) &status, 0, 0) == 0);
+	assert(simSyscall(YALNIX_RECLAIM, semaphore_id, 0, 0) == SUCCESS);
+}
+
+
+// Only readers can unlock a reader-writer lock, and a dead reader's hold goes away
+void testRWLockReaderKilled(ProcessDescriptor *driver) {
+	assert(simSyscall(YALNIX_CUSTOM_2, CUSTOM_RWLOCK_INIT, (long) &rwlock_id, 0) == SUCCESS);
+	RWLock *lock = (RWLock *) getResourceWithID(rwlock_id, RESOURCE_RWLOCK)->location;
+	assert(simSyscall(YALNIX_CUSTOM_2, CUSTOM_RWLOCK_READ, rwlock_id, 0) == SUCCESS);
+	ProcessDescriptor *reader = forkChild();
+	ProcessDescriptor *writer = forkChild();
+
+	runAs(reader);
+	assert(simSyscall(YALNIX_CUSTOM_2, CUSTOM_RWLOCK_UNLOCK, rwlock_id, 0) == ERROR);
+	assert(simSyscall(YALNIX_CUSTOM_2, CUSTOM_RWLOCK_READ, rwlock_id, 0) == SUCCESS);
+	assert(lock->readers == 2);
+
+	runAs(writer);
+	simSyscall(YALNIX_CUSTOM_2, CUSTOM_RWLOCK_WRITE, rwlock_id, 0);
+	assert(writer->state == PROCESS_WAITING);
+
+	// Once the reader is gone, our unlock is the last one the writer needs
+	runAs(driver);
+	simRunInKernel(killOther, reader);
+	assert(lock->readers == 1 && writer->state == PROCESS_WAITING);
+	assert(simSyscall(YALNIX_CUSTOM_2, CUSTOM_RWLOCK_UNLOCK, rwlock_id, 0) == SUCCESS);
+	assert(lock->writer == writer && writer->state == PROCESS_RUNNING);
+
+	// And the writer's hold goes away when it exits
+	runAs(writer);
+	simSyscall(YALNIX_EXIT, 0, 0, 0);
+
+	runAs(driver);
+	assert(lock->writer == 0 && lock->readers == 0);
+	assert(simSyscall(YALNIX_WAIT, (long) &status, 0, 0) == 0);
+	assert(simSyscall(YALNIX_WAIT, (long) &status, 0, 0) == 0);
+	assert(simSyscall(YALNIX_RECLAIM, rwlock_id, 0, 0) == SUCCESS);
+}
+
+
+// A participant that gets killed at the barrier doesn't count towards the next release
+void testBarrierWaiterKilled(ProcessDescriptor *driver) {
+	assert(simSyscall(YALNIX_CUSTOM_2, CUSTOM_BARRIER_INIT, (long) &barrier_id, 2) == SUCCESS);
+	Barrier *barrier = (Barrier *) getResourceWithID(barrier_id, RESOURCE_BARRIER)->location;
+	ProcessDescriptor *victim = forkChild();
+	ProcessDescriptor *partner = forkChild();
+
+	runAs(victim);
+	simSyscall(YALNIX_CUSTOM_2, CUSTOM_BARRIER_WAIT, barrier_id, 0);
+	assert(barrier->arrived == 1);
+
+	runAs(driver);
+	simRunInKernel(killOther, victim);
+	assert(barrier->arrived == 0);
+
+	// So we have to wait for the partner, who then wakes us up
+	simSyscall(YALNIX_CUSTOM_2, CUSTOM_BARRIER_WAIT, barrier_id, 0);
+	assert(driver->state == PROCESS_WAITING);
+	runAs(partner);
+	assert(simSyscall(YALNIX_CUSTOM_2, CUSTOM_BARRIER_WAIT, barrier_id, 0) == 1);
+	simSyscall(YALNIX_EXIT, 0, 0, 0);
+
+	runAs(driver);
+	assert(sim_user_context.regs[0] == 0);
+	assert(simSyscall(YALNIX_WAIT, (long) &status, 0, 0) == 0);
+	assert(simSyscall(YALNIX_WAIT, (long) &status, 0, 0) == 0);
+	assert(simSyscall(YALNIX_RECLAIM, barrier_id, 0, 0) == SUCCESS);
+}
+
+
+// Every lock a process holds sits on its own list, and moves with the lock
+void testHeldLocksFollowOwnership(ProcessDescriptor *driver) {
+	assert(simSyscall(YALNIX_LOCK_INIT, (long) &mutex_id, 0, 0) == SUCCESS);
+	assert(simSyscall(YALNIX_CUSTOM_2, CUSTOM_RWLOCK_INIT, (long) &rwlock_id, 0) == SUCCESS);
+	Mutex *mutex = (Mutex *) getResourceWithID(mutex_id, RESOURCE_MUTEX)->location;
+	RWLock *lock = (RWLock *) getResourceWithID(rwlock_id, RESOURCE_RWLOCK)->location;
+	ProcessDescriptor *child = forkChild();
+
+	runAs(child);
+	assert(simSyscall(YALNIX_LOCK_ACQUIRE, mutex_id, 0, 0) == SUCCESS);
+	assert(simSyscall(YALNIX_CUSTOM_2, CUSTOM_RWLOCK_READ, rwlock_id, 0) == SUCCESS);
+	assert(simSyscall(YALNIX_CUSTOM_2, CUSTOM_RWLOCK_READ, rwlock_id, 0) == SUCCESS);
+	assert(countHeldLocks(child) == 3);
+
+	// Block on the mutex, so the child's exit hands it to us
+	runAs(driver);
+	simSyscall(YALNIX_LOCK_ACQUIRE, mutex_id, 0, 0);
+	runAs(child);
+	simSyscall(YALNIX_EXIT, 0, 0, 0);
+
+	runAs(driver);
+	assert(sim_user_context.regs[0] == SUCCESS);
+	assert(lock->readers == 0);
+	assert(countHeldLocks(driver) == 1 && driver->held_locks.next == &mutex->hold.node);
+
+	// Reclaiming locks we still hold takes them off our list
+	assert(simSyscall(YALNIX_CUSTOM_2, CUSTOM_RWLOCK_WRITE, rwlock_id, 0) == SUCCESS);
+	assert(countHeldLocks(driver) == 2);
+	assert(simSyscall(YALNIX_RECLAIM, mutex_id, 0, 0) == SUCCESS);
+	assert(simSyscall(YALNIX_RECLAIM, rwlock_id, 0, 0) == SUCCESS);
+	assert(listIsEmpty(&driver->held_locks));
+	assert(simSyscall(YALNIX_WAIT, (long) &status, 0, 0) == 0);
+}
+
+
+
+// A futex wake only reaches sleepers in our own thread group, and only on the same word
+void testFutexWakesThreadGroup(ProcessDescriptor *driver) {
+	int *word = growHeap();
+	*word = 1;
+	ProcessDescriptor *child = forkChild();
+	ProcessDescriptor *thread = getProcessWithPID(simSyscall(YALNIX_CUSTOM_0, 0, 0, 0));
+	assert(getCurrentProcess() == driver && thread->thread_leader == driver);
+
+	runAs(child);
+	simSyscall(YALNIX_CUSTOM_2, CUSTOM_FUTEX_WAIT, (long) word, 1);
+	assert(child->state == PROCESS_WAITING);
+
+	// The word doesn't hold what the thread expects, so it gets to try again right away
+	runAs(thread);
+	assert(simSyscall(YALNIX_CUSTOM_2, CUSTOM_FUTEX_WAIT, (long) word, 0) == SUCCESS);
+	simSyscall(YALNIX_CUSTOM_2, CUSTOM_FUTEX_WAIT, (long) word, 1);
+	assert(thread->state == PROCESS_WAITING);
+
+	runAs(driver);
+	assert(simSyscall(YALNIX_CUSTOM_2, CUSTOM_FUTEX_WAIT, (long) word + 1, 1) == ERROR);
+	assert(simSyscall(YALNIX_CUSTOM_2, CUSTOM_FUTEX_WAIT, KERNEL_STACK_BASE, 1) == ERROR);
+	assert(simSyscall(YALNIX_CUSTOM_2, CUSTOM_FUTEX_WAKE, (long) (word + 1), 2) == 0);
+	assert(simSyscall(YALNIX_CUSTOM_2, CUSTOM_FUTEX_WAKE, (long) word, 2) == 1);
+	assert(thread->state == PROCESS_RUNNING && child->state == PROCESS_WAITING);
+
+	runAs(thread);
+	assert(sim_user_context.regs[0] == SUCCESS);
+	simSyscall(YALNIX_EXIT, 0, 0, 0);
+
+	runAs(driver);
+	simRunInKernel(killOther, child);
+	assert(simSyscall(YALNIX_CUSTOM_1, thread->pid, 0, 0) == 0);
+	assert(simSyscall(YALNIX_WAIT, (long) &status, 0, 0) == 0);
+}
+
+
+// Resource IDs stay unique as the table grows, a reused slot gets a new ID, and an
+// ID only ever finds a resource of its own type
+void testResourceHandles(ProcessDescriptor *driver) {
+	int ids[40];
+	for (int i=0; i<40; i++) {
+		assert(simSyscall(YALNIX_LOCK_INIT, (long) &ids[i], 0, 0) == SUCCESS);
+		for (int j=0; j<i; j++) assert(ids[j] != ids[i]);
+	}
+
+	for (int i=0; i<40; i++) {
+		assert(getResourceWithID(ids[i], RESOURCE_MUTEX));
+		assert(!getResourceWithID(ids[i], RESOURCE_CVAR));
+	}
+	assert(simSyscall(YALNIX_CVAR_SIGNAL, ids[0], 0, 0) == ERROR);
+
+	// The next mutex takes over the freed slot, but not the old ID
+	assert(simSyscall(YALNIX_RECLAIM, ids[0], 0, 0) == SUCCESS);
+	assert(simSyscall(YALNIX_LOCK_INIT, (long) &mutex_id, 0, 0) == SUCCESS);
+	assert(mutex_id != ids[0] && (mutex_id & 0xFFFF) == (ids[0] & 0xFFFF));
+	assert(simSyscall(YALNIX_LOCK_ACQUIRE, ids[0], 0, 0) == ERROR);
+	assert(simSyscall(YALNIX_RECLAIM, ids[0], 0, 0) == ERROR);
+
+	assert(simSyscall(YALNIX_RECLAIM, mutex_id, 0, 0) == SUCCESS);
+	for (int i=1; i<40; i++) assert(simSyscall(YALNIX_RECLAIM, ids[i], 0, 0) == SUCCESS);
+}
+
+
+
+int main() {
+	simBoot(NULL);
+
+	// Init reaps its zombies by itself, so the tests run in a child of it
+	ProcessDescriptor *driver = forkChild();
+	runAs(driver);
+
+	testMutexHolderExits(driver);
+	testSemaphoreWaiterKilled(driver);
+	testRWLockReaderKilled(driver);
+	testBarrierWaiterKilled(driver);
+	testHeldLocksFollowOwnership(driver);
+	testFutexWakesThreadGroup(driver);
+	testResourceHandles(driver);
+
+	printf("All tests passed!\n");
+	return 0;
+}
@@ -5,32 +5,82 @@
 #include <assert.h>
 #include <string.h>
 
+#include "../../include/yalnix.h"
 #include "../waitqueue.h"
 #include "../../process/process.h"
+#include "../../sim/sim.h"
 
 
-void testWaitQueue() {
-	ProcessDescriptor process_a;
-	ProcessDescriptor process_b;
+newWaitQueue(waitqueue_a);
+int sleep_result;
 
-	newWaitQueue(waitqueue_a);
 
-	sleepOnWaitQueue(&process_a, &waitqueue_a);
-	assert(process_a.state == PROCESS_WAITING);
+// These run inside the kernel, on behalf of whichever process is current
+void sleepOnQueue(void *queue) {
+	sleep_result = 1;
+	sleep_result = sleepOnWaitQueue((WaitQueue *) queue);
+}
+
+void sleepUntilTimeout(void *queue) {
+	void *data;
+	sleep_result = 1;
+	sleep_result = sleepOnWaitQueueWithTimeout((WaitQueue *) queue, &data, deadlineAfterTicks(2));
+}
+
+void signalQueue(void *queue) {
+	signalWaitQueue((WaitQueue *) queue);
+}
+
+
+void testWaitQueue(ProcessDescriptor *process_a, ProcessDescriptor *process_b) {
+
+	// Put $process_a to sleep, so the kernel comes back out in $process_b
+	simRunInKernel(sleepOnQueue, &waitqueue_a);
+	assert(process_a->state == PROCESS_WAITING);
+	assert(getCurrentProcess() == process_b);
+	assert(sleep_result == 1);
+
+	// Wake $process_a back up from $process_b, then let the scheduler switch to it
+	simRunInKernel(signalQueue, &waitqueue_a);
+	assert(process_a->state == PROCESS_RUNNING);
+	assert(getCurrentProcess() == process_b);
 
-	sleepOnWaitQueueWithOptions(&process_b, &waitqueue_a, 1);
-	assert(process_b.state == PROCESS_WAITING);
-	
-	signalWaitQueue(&waitqueue_a);
-	assert(process_a.state == PROCESS_RUNNING);
-	assert(process_b.state == PROCESS_RUNNING);
+	simTick();
+	assert(getCurrentProcess() == process_a);
+	assert(sleep_result == 0);
+}
+
+
+void testWaitQueueTimeout(ProcessDescriptor *process_a, ProcessDescriptor *process_b) {
+	simRunInKernel(sleepUntilTimeout, &waitqueue_a);
+	assert(process_a->state == PROCESS_WAITING);
+	assert(getCurrentProcess() == process_b);
+
+	// Nobody signals the waitqueue, so $process_a should give up after two ticks
+	simTick();
+	assert(getCurrentProcess() == process_b);
+
+	simTick();
+	assert(getCurrentProcess() == process_a);
+	assert(sleep_result == TIMEOUT);
+	assert(waitqueue_a.head.next == &waitqueue_a.head);
 }
 
 
 
 int main() {
-	testWaitQueue();
+	simBoot(NULL);
+	ProcessDescriptor *process_a = getCurrentProcess();
+
+	// Fork, so there's someone to switch to. The parent comes back out of the kernel.
+	PID pid = simSyscall(YALNIX_FORK, 0, 0, 0);
+	assert(getCurrentProcess() == process_a);
+	ProcessDescriptor *process_b = getProcessWithPID(pid);
+	assert(process_b);
+
+	testWaitQueue(process_a, process_b);
+	testWaitQueueTimeout(process_a, process_b);
 
 	printf("All tests passed!\n");
 	return 0;
-}
\ No newline at end of file
+}
@@ -17,6 +17,7 @@
 
 #include "../core/list.h"
 #include "../process/process.h"
+#include "../traps/traps.h"
 #include "sync.h"
 
 
@@ -48,12 +49,32 @@ void releaseSpinlock(Spinlock *lock) {
 
 
 
+/*
+  Processes that sleep with a deadline are also kept on a list sorted by deadline,
+  so the clock handler only has to look at the front of it.
+*/
+
+static LinkedListNode wait_timers = linkedListNode(wait_timers);
+
+static void addTimer(WaitQueueNode *node) {
+	LinkedListNode *position = wait_timers.prev;
+	while (position != &wait_timers && elementForNode(position, WaitQueueNode, timer)->deadline > node->deadline) {
+		position = position->prev;
+	}
+
+	insertNode(&node->timer, position);
+}
+
+
+
+
 /*
   Allow a process to add itself to a waitqueue, then sleep until it is woken up.
 */
 
 // Add a waitqueue node to a waitqueue
 void addNodeToWaitQueue(WaitQueueNode *node, WaitQueue *head) {
+	node->queue = head;
 
 	// If this node is exclusive, add it to the back of the queue. Otherwise,
 	// if it's non-exclusive, add it to the front so it will be woken up first.
@@ -79,11 +100,49 @@ int sleepOnWaitQueueWithOptions(WaitQueue *head, int exclusive) {
 
 	// Add the node to the waitqueue, then put the process to sleep.
 	addNodeToWaitQueue(node, head);
-	putProcessToSleep();
+	putProcessToSleep(head);
 
+	getCurrentProcess()->waitqueue = 0;
 	return 0;
 }
 
+// Sleep on a waitqueue, handing $data to whoever wakes us up and taking back
+// whatever data they leave in the node for us
+int sleepOnWaitQueueWithData(WaitQueue *head, void **data) {
+	return sleepOnWaitQueueWithTimeout(head, data, NO_DEADLINE);
+}
+
+// Same as above, but give up once the clock reaches $deadline. Returns TIMEOUT
+// if nobody woke us up in time, in which case we're no longer on the waitqueue.
+int sleepOnWaitQueueWithTimeout(WaitQueue *head, void **data, long deadline) {
+	if (deadline <= elapsed_clock_ticks) return TIMEOUT;
+
+	WaitQueueNode *node = (WaitQueueNode*) malloc(sizeof(WaitQueueNode));
+	if (!node) return ERROR;
+
+	// Set up a new waitqueue node that will outlive the wakeup
+	waitQueueNodeInit(node);
+	node->is_exclusive = 1;
+	node->prepareToWakeUp = &wakeUpProcessWithData;
+	node->data = *data;
+	node->deadline = deadline;
+	getCurrentProcess()->waitqueue = node;
+
+	if (deadline != NO_DEADLINE) addTimer(node);
+
+	// Add the node to the waitqueue, then put the process to sleep.
+	addNodeToWaitQueue(node, head);
+	putProcessToSleep(head);
+
+	getCurrentProcess()->waitqueue = 0;
+	cancelWaitQueueTimer(node);
+
+	int timed_out = node->timed_out;
+	*data = node->data;
+	free(node);
+	return timed_out ? TIMEOUT : 0;
+}
+
 
 
 
@@ -99,16 +158,16 @@ void signalWaitQueue(WaitQueue *head) {
 }
 
 void signalWaitQueueWithOptions(WaitQueue *head, int wakeup_is_exclusive) {
-	WaitQueueNode *current;
 
 	// If we're doing an exclusive wakeup, start dequeueing nodes until we
 	// successfully wake up an exclusive process. Otherwise, just wake up everthing.
-	forEachElement(current, &head->head, node) {
-		removeFirstNode(&head->head);
-		
+	// Waking a node might free it, so always start over from the front.
+	while (!listIsEmpty(&head->head)) {
+		WaitQueueNode *current = elementForNode(removeFirstNode(&head->head), WaitQueueNode, node);
+
 		int node_is_exclusive = current->is_exclusive;
 		current->prepareToWakeUp(current);
-		
+
 		if (node_is_exclusive && wakeup_is_exclusive) break;
 	}
 }
@@ -117,16 +176,92 @@ void signalWaitQueueWithOptions(WaitQueue *head, int wakeup_is_exclusive) {
 
 
 /*
-  Functions to put to sleep and wake up a process
+  Functions to put to sleep and wake up a process. $head is only used for
+  tracing, so it can be 0 if the process isn't sleeping on a waitqueue.
 */
 
-void putProcessToSleep() {
+void putProcessToSleep(WaitQueue *head) {
 	getCurrentProcess()->state = PROCESS_WAITING;
+	countStat(waitqueue_sleeps);
+	traceEvent(TRACE_SLEEP, head, 0);
 	schedule();
 }
 
+// Make a sleeping process runnable again, and note when so we can trace how long
+// it waits for the CPU. Message passing uses this too.
+void markProcessRunnable(ProcessDescriptor *process) {
+	process->state = PROCESS_RUNNING;
+	process->woken_at = readCycleCounter();
+	traceEvent(TRACE_WAKEUP, process->pid, 0);
+}
+
 int wakeUpProcess(WaitQueueNode *node) {
-	node->process->state = PROCESS_RUNNING;
+	markProcessRunnable(node->process);
 	free(node);
 	return 0;
 }
+
+// Wake up a process without freeing its node, so it can read the node's data
+int wakeUpProcessWithData(WaitQueueNode *node) {
+	markProcessRunnable(node->process);
+	return 0;
+}
+
+
+
+
+/*
+  Functions to manage deadlines
+*/
+
+// Turn a timeout in clock ticks into a deadline
+long deadlineAfterTicks(int ticks) {
+	return elapsed_clock_ticks + ticks;
+}
+
+// Stop a node's deadline from going off
+void cancelWaitQueueTimer(WaitQueueNode *node) {
+	removeNode(&node->timer);
+	linkedListNodeInit(&node->timer);
+}
+
+// Take a node off its waitqueue without waking it up, and let the waitqueue know
+static void leaveWaitQueue(WaitQueueNode *node) {
+	removeNode(&node->node);
+	linkedListNodeInit(&node->node);
+	if (node->queue && node->queue->waiterDetached) node->queue->waiterDetached(node->queue, node);
+}
+
+// Called on every clock tick. Pull any process whose deadline has passed off its
+// waitqueue and wake it up. Processes that were already woken up are left alone.
+void expireWaitQueueTimers() {
+	while (!listIsEmpty(&wait_timers)) {
+		WaitQueueNode *node = elementForNode(wait_timers.next, WaitQueueNode, timer);
+		if (node->deadline > elapsed_clock_ticks) return;
+
+		cancelWaitQueueTimer(node);
+		if (node->process->state != PROCESS_WAITING) continue;
+
+		leaveWaitQueue(node);
+		node->timed_out = 1;
+		node->prepareToWakeUp(node);
+	}
+}
+
+
+
+
+/*
+  Take a process that's being killed off whatever waitqueue it's sleeping on, so
+  the waitqueue isn't left pointing at it
+*/
+
+void detachFromWaitQueue(struct ProcessDescriptor *process) {
+	WaitQueueNode *node = process->waitqueue;
+	if (!node || process->state != PROCESS_WAITING) return;
+
+	leaveWaitQueue(node);
+	cancelWaitQueueTimer(node);
+	free(node);
+	process->waitqueue = 0;
+}
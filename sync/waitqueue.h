@@ -0,0 +1,175 @@
+/*
+  File: waitqueue.h
+  Date: 10/8/2014
+  Author: Mitchell Goff
+*/
+
+#ifndef __YALNIX_WAITQUEUE_H__
+#define __YALNIX_WAITQUEUE_H__
+
+
+
+/* =============================== *
+
+  			  Includes
+
+ * =============================== */
+
+#include <limits.h>
+
+#include "../core/list.h"
+
+
+
+
+
+/* =============================== *
+
+  		   Data Structures
+
+ * =============================== */
+
+struct ProcessDescriptor;
+struct WaitQueueNode;
+struct WaitQueue;
+
+typedef struct WaitQueueNode WaitQueueNode;
+typedef struct WaitQueue WaitQueue;
+
+typedef int (*WaitQueueHandler) (WaitQueueNode*);
+typedef void (*WaitQueueDetachHandler) (WaitQueue*, WaitQueueNode*);
+
+
+
+
+/*
+  The WaitQueueNode struct allows processes to add themselves to a
+  waitqueue and get notified when some event becomes true.
+
+  is_exclusive:   Determines whether the process is exclusive or not
+  wakeup_handler: The function to run when the process gets off the waitqueue
+  process:      The process to add to the waitqueue
+  data:       Some extra data that the sleeper and the waker can pass to each other
+  node:       A linked list node for the waitqueue to hook onto
+  queue:      The waitqueue the node was last added to
+
+  deadline:   The clock tick at which the sleeper gives up, or NO_DEADLINE
+  timed_out:  Set if the sleeper was woken up by its deadline instead of a signal
+  timer:      A linked list node for the list of pending deadlines to hook onto
+*/
+
+struct WaitQueueNode {
+    unsigned int is_exclusive;
+    WaitQueueHandler prepareToWakeUp;
+    struct ProcessDescriptor *process;
+    void *data;
+    LinkedListNode node;
+    WaitQueue *queue;
+
+    long deadline;
+    int timed_out;
+    LinkedListNode timer;
+};
+
+
+
+
+/*
+  The WaitQueue struct keeps track of a single waitqueue and allows us to
+  iterate over all the processes, or to dequeue just the next process.
+
+  waiterDetached: Run with the sleeper's node when it leaves the waitqueue without
+                  being woken up, because it timed out or got killed. This can
+                  be 0.
+*/
+
+struct WaitQueue {
+    LinkedListNode head;
+    WaitQueueDetachHandler waiterDetached;
+};
+
+
+
+
+
+/* =============================== *
+
+  		      Macros
+
+ * =============================== */
+
+// A deadline that never comes
+#define NO_DEADLINE LONG_MAX
+
+
+
+
+/*
+  Macros and functions to create an initialize waitqueues
+*/
+
+// Statically initialize a new waitqueue
+#define waitQueue(name) { linkedListNode((name).head), 0 }
+
+// Dynamically initialize a new waitqueue
+#define waitQueueInit(name) \
+    linkedListNodeInit(&(name)->head); \
+    (name)->waiterDetached = 0
+
+// Create a new waitqueue variable
+#define newWaitQueue(name) \
+    WaitQueue name = waitQueue(name)
+
+
+
+// Statically initialize a new waitqueue node
+#define waitQueueNode(name) { 1, &wakeUpProcess, getCurrentProcess(), 0, linkedListNode((name).node), 0, \
+    NO_DEADLINE, 0, linkedListNode((name).timer) }
+
+// Dynamically initialize a new waitqueue node
+#define waitQueueNodeInit(name) \
+    (name)->is_exclusive = 0; \
+    (name)->prepareToWakeUp = &wakeUpProcess; \
+    (name)->process = getCurrentProcess(); \
+    (name)->data = 0; \
+    linkedListNodeInit(&(name)->node); \
+    (name)->queue = 0; \
+    (name)->deadline = NO_DEADLINE; \
+    (name)->timed_out = 0; \
+    linkedListNodeInit(&(name)->timer)
+
+// Create a new waitqueue node variable
+#define newWaitQueueNode(name) \
+    WaitQueueNode name = waitQueueNode(name)
+
+
+
+
+
+/* =============================== *
+
+             Interface
+
+ * =============================== */
+
+void addNodeToWaitQueue(WaitQueueNode *node, WaitQueue *head);
+int sleepOnWaitQueue(WaitQueue *head);
+int sleepOnWaitQueueWithOptions(WaitQueue *head, int exclusive);
+int sleepOnWaitQueueWithData(WaitQueue *head, void **data);
+int sleepOnWaitQueueWithTimeout(WaitQueue *head, void **data, long deadline);
+void signalWaitQueue(WaitQueue *head);
+void signalWaitQueueWithOptions(WaitQueue *head, int exclusive);
+
+void putProcessToSleep(WaitQueue *head);
+void markProcessRunnable(struct ProcessDescriptor *process);
+int wakeUpProcess(WaitQueueNode *node);
+int wakeUpProcessWithData(WaitQueueNode *node);
+
+long deadlineAfterTicks(int ticks);
+void cancelWaitQueueTimer(WaitQueueNode *node);
+void expireWaitQueueTimers();
+void detachFromWaitQueue(struct ProcessDescriptor *process);
+
+
+
+#endif
@@ -0,0 +1,237 @@
+/*
+  File: tracedecode.c
+  Date: 10/19/2026
+  Author: Mitchell Goff
+*/
+
+
+/* =============================== *
+
+             Includes
+
+ * =============================== */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../include/custom.h"
+
+
+
+
+/* =============================== *
+
+               Data
+
+ * =============================== */
+
+/*
+  Turns the "trace ..." lines that apps/tracedump writes to the console back into
+  something readable. Reads a TTYLOG file (or stdin), ignores everything that isn't
+  a trace line, and prints each event with its time relative to the first one.
+
+  With -j, writes a Chrome trace (JSON) instead, which chrome://tracing or Perfetto
+  can load: one track per process showing when it ran and why it stopped, plus a
+  counter for the run queue. -m sets the clock rate in MHz used to turn cycles into
+  microseconds (1000 by default).
+
+    usage: tracedecode [-j] [-m mhz] [file]
+*/
+
+struct TraceName {
+	unsigned int type;
+	char *name;
+};
+
+static struct TraceName trace_names[] = {
+	{TRACE_FRAME_ALLOC,      "frame_alloc"},
+	{TRACE_FRAME_FREE,       "frame_free"},
+	{TRACE_FRAME_FREE_BATCH, "frame_free_batch"},
+	{TRACE_BRK_GROW,         "brk_grow"},
+	{TRACE_BRK_SHRINK,       "brk_shrink"},
+	{TRACE_KERNEL_BRK,       "kernel_brk"},
+	{TRACE_MEMORY_PRESSURE,  "memory_pressure"},
+	{TRACE_OOM_KILL,         "oom_kill"},
+	{TRACE_CLOCK,            "clock"},
+	{TRACE_DISK,             "disk"},
+	{TRACE_SYSCALL_ENTER,    "syscall_enter"},
+	{TRACE_SYSCALL_EXIT,     "syscall_exit"},
+	{TRACE_SWITCH,           "switch"},
+	{TRACE_SLEEP,            "sleep"},
+	{TRACE_WAKEUP,           "wakeup"},
+	{TRACE_RUN_LATENCY,      "run_latency"},
+};
+
+static char *switch_reasons[] = {"tick", "block", "delay", "exit"};
+
+#define TRACE_NAMES (sizeof(trace_names) / sizeof(trace_names[0]))
+
+
+
+
+/* =============================== *
+
+           Implementation
+
+ * =============================== */
+
+// Look up the name of an event type
+static char *traceName(unsigned int type) {
+	for (unsigned int i=0; i<TRACE_NAMES; i++) {
+		if (trace_names[i].type == type) return trace_names[i].name;
+	}
+	return "unknown";
+}
+
+
+
+
+// Look up why a process stopped running in a TRACE_SWITCH event
+static char *switchReason(unsigned int reason) {
+	return reason < sizeof(switch_reasons) / sizeof(switch_reasons[0]) ? switch_reasons[reason] : "unknown";
+}
+
+
+
+
+// Parse one line from the console. Returns 1 if it was a trace event.
+static int parseEvent(char *line, TraceEvent *event) {
+	char *start = strstr(line, "trace ");
+	if (!start) return 0;
+
+	int fields = sscanf(start, "trace %x %x %x %x %x %x %x", &event->sequence,
+		&event->timestamp_high, &event->timestamp_low, &event->pid, &event->type,
+		&event->args[0], &event->args[1]);
+	return fields == 7;
+}
+
+
+
+
+// Print one event as a line of text
+static void printEvent(TraceEvent *event, unsigned long long time) {
+	printf("%8u %14llu  pid %-4u %-18s ", event->sequence, time, event->pid, traceName(event->type));
+
+	switch (event->type) {
+		case TRACE_SWITCH:
+			printf("-> pid %u (%s, %u runnable)\n", event->args[0], switchReason(event->args[1] & 0xFF),
+				event->args[1] >> 8);
+			break;
+		case TRACE_RUN_LATENCY:
+			printf("pid %u waited %u cycles\n", event->args[0], event->args[1]);
+			break;
+		default:
+			printf("%x %x\n", event->args[0], event->args[1]);
+	}
+}
+
+
+
+
+/*
+  Chrome trace output. Each Yalnix process gets its own track (a "tid" in the
+  trace), and the time between two TRACE_SWITCH events becomes a slice on the
+  track of whoever was running. Everything else is an instant event.
+*/
+
+static int json_events = 0;
+static unsigned int running_pid = 0;
+static double running_since = -1;
+
+// Start a new JSON event, with a comma if it isn't the first
+static void jsonEvent(char *phase, char *name, unsigned int tid, double ts) {
+	printf("%s\n  {\"ph\": \"%s\", \"name\": \"%s\", \"pid\": 0, \"tid\": %u, \"ts\": %.3f",
+		json_events++ ? "," : "", phase, name, tid, ts);
+}
+
+static void printJSONEvent(TraceEvent *event, double ts) {
+	switch (event->type) {
+		case TRACE_SWITCH:
+			if (running_since >= 0) {
+				jsonEvent("X", "run", running_pid, running_since);
+				printf(", \"dur\": %.3f, \"args\": {\"stopped\": \"%s\"}}", ts - running_since,
+					switchReason(event->args[1] & 0xFF));
+			}
+			jsonEvent("C", "runnable", 0, ts);
+			printf(", \"args\": {\"processes\": %u}}", event->args[1] >> 8);
+
+			running_pid = event->args[0];
+			running_since = ts;
+			break;
+
+		case TRACE_SLEEP:
+			jsonEvent("i", "sleep", event->pid, ts);
+			printf(", \"s\": \"t\", \"args\": {\"waitqueue\": \"%x\"}}", event->args[0]);
+			break;
+
+		case TRACE_WAKEUP:
+			jsonEvent("i", "wakeup", event->args[0], ts);
+			printf(", \"s\": \"t\", \"args\": {\"by\": %u}}", event->pid);
+			break;
+
+		case TRACE_RUN_LATENCY:
+			jsonEvent("i", "run_latency", event->args[0], ts);
+			printf(", \"s\": \"t\", \"args\": {\"cycles\": %u}}", event->args[1]);
+			break;
+
+		default:
+			jsonEvent("i", traceName(event->type), event->pid, ts);
+			printf(", \"s\": \"t\", \"args\": {\"a\": \"%x\", \"b\": \"%x\"}}", event->args[0], event->args[1]);
+	}
+}
+
+
+
+
+int main(int argc, char *argv[]) {
+	int json = 0;
+	double mhz = 1000;
+	int i = 1;
+
+	for (; i < argc && argv[i][0] == '-'; i++) {
+		if (strcmp(argv[i], "-j") == 0) json = 1;
+		else if (strcmp(argv[i], "-m") == 0 && i+1 < argc && atof(argv[i+1]) > 0) mhz = atof(argv[++i]);
+		else {
+			fprintf(stderr, "usage: %s [-j] [-m mhz] [file]\n", argv[0]);
+			return 1;
+		}
+	}
+
+	FILE *input = stdin;
+	if (i < argc && !(input = fopen(argv[i], "r"))) {
+		perror(argv[i]);
+		return 1;
+	}
+
+	char line[256];
+	TraceEvent event;
+	int first = 1;
+	unsigned long long start = 0;
+	unsigned int expected = 0;
+
+	if (json) printf("{\"traceEvents\": [");
+
+	while (fgets(line, sizeof(line), input)) {
+		if (!parseEvent(line, &event)) continue;
+		unsigned long long timestamp = ((unsigned long long) event.timestamp_high << 32) | event.timestamp_low;
+
+		if (first) {
+			start = timestamp;
+			first = 0;
+		} else if (event.sequence != expected) {
+			// The ring wrapped between events, or the dump lost some lines
+			if (json) running_since = -1;
+			else printf("... %u events dropped\n", event.sequence - expected);
+		}
+		expected = event.sequence + 1;
+
+		if (json) printJSONEvent(&event, (timestamp - start) / mhz);
+		else printEvent(&event, timestamp - start);
+	}
+
+	if (json) printf("\n]}\n");
+
+	if (input != stdin) fclose(input);
+	return 0;
+}
@@ -14,6 +14,7 @@
 
 #include "../include/hardware.h"
 #include "../include/yalnix.h"
+#include "../include/custom.h"
 
 #include "../memory/memory.h"
 #include "../process/process.h"
@@ -47,10 +48,16 @@ long elapsed_clock_ticks = 0;
 */
 
 void trapClock(UserContext *context) {
-    TracePrintf(1, "TRAP_CLOCK\n");
+    countTrap(TRAP_CLOCK);
     saveUserContext();
     
     elapsed_clock_ticks++;
+    traceEvent(TRACE_CLOCK, elapsed_clock_ticks, 0);
+    expireWaitQueueTimers();
+    checkMemoryPressure();
+    checkMemoryPeriodically();
+    refillKernelStackPool();
+    reapOrphanedZombies();
     schedule();
     
     restoreUserContext();
@@ -64,7 +71,8 @@ void trapClock(UserContext *context) {
 */
 
 void trapDisk(UserContext *context) {
-    TracePrintf(1, "TRAP_DISK\n");
+    countTrap(TRAP_DISK);
+    traceEvent(TRACE_DISK, 0, 0);
     // pass
 }
 
@@ -76,6 +84,7 @@ void trapDisk(UserContext *context) {
 */
 
 void trapTtyReceive(UserContext *context) {
+    countTrap(TRAP_TTY_RECEIVE);
     // TracePrintf(1, "TRAP_TTY_RECEIVE\n");
     ttyReadBegin(context->code);
 }
@@ -88,6 +97,7 @@ void trapTtyReceive(UserContext *context) {
 */
 
 void trapTtyTransmit(UserContext *context) {
+    countTrap(TRAP_TTY_TRANSMIT);
     // TracePrintf(1, "TRAP_TTY_TRANSMIT\n");
     ttyWriteFinished(context->code);
 }
@@ -102,17 +112,82 @@ void trapTtyTransmit(UserContext *context) {
 
  * =============================== */
 
+/*
+  Custom2 multiplexes our extended syscalls. The operation is passed in the first
+  argument (see include/custom.h), and its arguments follow in the next ones.
+*/
+
+static long trapCustom(int operation) {
+    switch(operation) {
+        case CUSTOM_FUTEX_WAIT: return futexWait((int *) register(1), register(2));
+        case CUSTOM_FUTEX_WAKE: return futexWake((int *) register(1), register(2));
+
+        case CUSTOM_SEM_UP_N: return semaphoreUp(register(1), register(2));
+        case CUSTOM_SEM_DOWN_N: return semaphoreDown(register(1), register(2));
+        case CUSTOM_SEM_TRY_DOWN: return semaphoreTryDown(register(1), register(2));
+
+        case CUSTOM_RWLOCK_INIT: return rwlockInitialize((int *) register(1));
+        case CUSTOM_RWLOCK_READ: return rwlockReadLock(register(1));
+        case CUSTOM_RWLOCK_WRITE: return rwlockWriteLock(register(1));
+        case CUSTOM_RWLOCK_UNLOCK: return rwlockUnlock(register(1));
+
+        case CUSTOM_BARRIER_INIT: return barrierInitialize((int *) register(1), register(2));
+        case CUSTOM_BARRIER_WAIT: return barrierWait(register(1));
+
+        case CUSTOM_LOCK_ACQUIRE_TIMED: return mutexAcquireWithTimeout(register(1), register(2));
+        case CUSTOM_CVAR_WAIT_TIMED:
+            return cvarWaitWithTimeout(register(1), register(2), register(3));
+        case CUSTOM_TTY_READ_TIMED:
+            return ttyReadWithTimeout(ttyOfPackedTimeout(register(1)), (void *) register(2), register(3),
+                ticksOfPackedTimeout(register(1)));
+
+        case CUSTOM_KERNEL_STATS: return copyKernelStats((void *) register(1), register(2));
+        case CUSTOM_SYSCALL_LATENCY: return copySyscallLatency(register(1), (void *) register(2));
+        case CUSTOM_STATS_RESET: resetKernelStats(); return SUCCESS;
+
+        case CUSTOM_TRACE_READ: return copyTraceEvents((void *) register(1), register(2));
+        case CUSTOM_TRACE_MASK: return setTraceMask(register(1));
+
+        case CUSTOM_CLOCK_TICKS: return elapsed_clock_ticks;
+        case CUSTOM_MEMORY_USAGE: return copyMemoryUsage(register(1), (void *) register(2));
+        case CUSTOM_MEMORY_PRESSURE: return waitForMemoryPressure();
+#if FAULT_INJECTION
+        case CUSTOM_FAULT_INJECT: return setFaultInjection(register(1), register(2), register(3));
+#endif
+#if MEMORY_CHECK
+        case CUSTOM_MEMORY_CHECK: return checkMemoryInvariants();
+#endif
+    }
+
+    TracePrintf(1, "Unknown extended syscall %d\n", operation);
+    return ERROR;
+}
+
+
+
+
 /*
   When a TRAP_KERNEL interrupt is recieved, trigger the appropriate syscall
 */
 
 void trapKernel(UserContext *context) {
+    countTrap(TRAP_KERNEL);
     // TracePrintf(1, "TRAP_KERNEL\n");
     saveUserContext();
     int result;
 
+    // Hang on to the code, since $context belongs to someone else while we're asleep.
+    // Custom2 calls get timed per operation too, so hang on to that as well.
+    int code = context->code;
+    int operation = register(0);
+    unsigned long long start = readCycleCounter();
+    countSyscall(code);
+    traceEvent(TRACE_SYSCALL_ENTER, code, 0);
+
     switch(context->code) {
 
+        case YALNIX_NOP: register(0) = SUCCESS; break;
+
         case YALNIX_FORK:
             result = forkProcess();
             register(0) = result;
@@ -120,6 +195,9 @@ void trapKernel(UserContext *context) {
         
         case YALNIX_EXEC:
             result = loadProgram((char *) register(0), (char **) register(1));
+
+            // If we failed after throwing out the old program, there's nothing to go back to
+            if (result == KILL) killCurrentProcess(ERROR);
             register(0) = result;
             break;
 
@@ -137,6 +215,26 @@ void trapKernel(UserContext *context) {
             register(0) = ttyWrite(register(0), (void *) register(1), register(2)); break;
 
 
+        case YALNIX_REGISTER: register(0) = registerService(register(0)); break;
+        case YALNIX_SEND: register(0) = sendMessage((void *) register(0), register(1)); break;
+        case YALNIX_RECEIVE: register(0) = receiveMessage((void *) register(0), 0); break;
+        case YALNIX_RECEIVESPECIFIC:
+            register(0) = receiveMessage((void *) register(0), register(1)); break;
+        case YALNIX_REPLY: register(0) = replyToMessage((void *) register(0), register(1)); break;
+        case YALNIX_FORWARD:
+            register(0) = forwardMessage((void *) register(0), register(1), register(2)); break;
+        case YALNIX_COPY_FROM:
+            register(0) = copyFromProcess(register(0), (void *) register(1), (void *) register(2), register(3)); break;
+        case YALNIX_COPY_TO:
+            register(0) = copyToProcess(register(0), (void *) register(1), (void *) register(2), register(3)); break;
+
+
+        case YALNIX_PIPE_INIT: register(0) = pipeInitialize((int *) register(0)); break;
+        case YALNIX_PIPE_READ:
+            register(0) = pipeRead(register(0), (void *) register(1), register(2)); break;
+        case YALNIX_PIPE_WRITE:
+            register(0) = pipeWrite(register(0), (void *) register(1), register(2)); break;
+
         case YALNIX_LOCK_INIT: register(0) = mutexInitialize((int *) register(0)); break;
         case YALNIX_LOCK_ACQUIRE: register(0) = mutexAcquire(register(0)); break;
         case YALNIX_LOCK_RELEASE: register(0) = mutexRelease(register(0)); break;
@@ -146,6 +244,12 @@ void trapKernel(UserContext *context) {
         case YALNIX_CVAR_SIGNAL: register(0) = cvarSignal(register(0)); break;
         case YALNIX_CVAR_BROADCAST: register(0) = cvarBroadcast(register(0)); break;
 
+        case YALNIX_SEM_INIT: register(0) = semaphoreInitialize((int *) register(0), register(1)); break;
+        case YALNIX_SEM_UP: register(0) = semaphoreUp(register(0), 1); break;
+        case YALNIX_SEM_DOWN: register(0) = semaphoreDown(register(0), 1); break;
+
+        case YALNIX_RECLAIM: register(0) = reclaimResource(register(0)); break;
+
 
         case YALNIX_CUSTOM_0:
             result = createThread();
@@ -153,8 +257,13 @@ void trapKernel(UserContext *context) {
             break;
 
         case YALNIX_CUSTOM_1: register(0) = joinThread(register(0)); break;
+        case YALNIX_CUSTOM_2: register(0) = trapCustom(register(0)); break;
     }
 
+    unsigned long long cycles = readCycleCounter() - start;
+    recordSyscallLatency(code, cycles);
+    if (code == YALNIX_CUSTOM_2) recordSyscallLatency(STATS_CUSTOM_LATENCY(operation), cycles);
+    traceEvent(TRACE_SYSCALL_EXIT, code, register(0));
     restoreUserContext();
 }
 
@@ -173,6 +282,7 @@ void trapKernel(UserContext *context) {
 */
 
 void trapIllegal(UserContext *context) {
+    countTrap(TRAP_ILLEGAL);
     TracePrintf(1, "Process %d has received a TRAP_ILLEGAL\n", getCurrentProcess()->pid);
     killCurrentProcess(-1);
 }
@@ -185,6 +295,7 @@ void trapIllegal(UserContext *context) {
 */
 
 void trapMath(UserContext *context) {
+    countTrap(TRAP_MATH);
     TracePrintf(1, "Process %d has received a TRAP_MATH\n", getCurrentProcess()->pid);
     killCurrentProcess(-1);
 }
@@ -198,6 +309,7 @@ void trapMath(UserContext *context) {
 */
 
 void trapMemory(UserContext *context) {
+    countTrap(TRAP_MEMORY);
     // TracePrintf(1, "TRAP_MEMORY\n");
     saveUserContext();
     
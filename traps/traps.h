@@ -80,6 +80,7 @@ void trapMath(UserContext *context);
 
 
 int ttyRead(int tty, void *u_buffer, int u_length);
+int ttyReadWithTimeout(int tty, void *u_buffer, int u_length, int ticks);
 void ttyReadBegin(int tty);
 
 int ttyWrite(int tty, void *u_buffer, int length);
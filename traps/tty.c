@@ -45,16 +45,19 @@ TTY ttys[NUM_TERMINALS];
  * =============================== */
 
 /*
-  Copy the contents of the tty read buffer into the user space
+  Copy the contents of the tty read buffer into the user space, giving up if no
+  input arrives before the deadline
 */
 
-int ttyRead(int tty, void *u_buffer, int u_length) {
+static int readTTY(int tty, void *u_buffer, int u_length, long deadline) {
 	if (tty >= NUM_TERMINALS || tty < 0) return ERROR;
 
 	// First, check if there's any data ready right now
 	WaitQueue *queue = &ttys[tty].read_queue;
 	while (!ttys[tty].read_buffer || ttys[tty].read_buffer_position >= ttys[tty].read_buffer_size) {
-		sleepOnWaitQueue(queue);
+		void *data = 0;
+		int result = sleepOnWaitQueueWithTimeout(queue, &data, deadline);
+		if (result == TIMEOUT || result == ERROR) return result;
 	}
 
 	long length = ttys[tty].read_buffer_size;
@@ -70,6 +73,19 @@ int ttyRead(int tty, void *u_buffer, int u_length) {
 	return sub_length;
 }
 
+int ttyRead(int tty, void *u_buffer, int u_length) {
+	return readTTY(tty, u_buffer, u_length, NO_DEADLINE);
+}
+
+int ttyReadWithTimeout(int tty, void *u_buffer, int u_length, int ticks) {
+	if (ticks < 0) {
+		TracePrintf(1, "Hey, we can't go back in time!\n");
+		return ERROR;
+	}
+
+	return readTTY(tty, u_buffer, u_length, deadlineAfterTicks(ticks));
+}
+
 
 
 